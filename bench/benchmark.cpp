@@ -0,0 +1,256 @@
+#include "../src/binary_tree_array_list.h"
+#include "../src/bounded_binary_tree_array_list.h"
+#include "../src/compressed_view.h"
+#include "../src/packed_binary_tree_array_list.h"
+#include "../src/s_tree_view.h"
+#include "../src/staged_binary_tree_array_list.h"
+#include "../src/string_binary_tree_array_list.h"
+#include "../src/veb_view.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace imdast;
+using imdast::bench::perf_counters;
+
+namespace {
+// Prevents the optimizer from discarding a benchmark's result.
+volatile uint64_t sink;
+
+// Runs one benchmark case and prints its timing, and the hardware counters
+// per operation if they were requested.
+void run_case(const char *name, size_t ops, perf_counters *counters,
+              const std::function<void()> &body) {
+  if (counters)
+    counters->start();
+  auto start = std::chrono::steady_clock::now();
+  body();
+  auto stop = std::chrono::steady_clock::now();
+  if (counters)
+    counters->stop();
+
+  double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+  std::printf("%-20s %10.2f ms %9.2f ns/op", name, ns / 1e6, ns / ops);
+  if (counters) {
+    for (int e = 0; e < perf_counters::EVENT_COUNT; e++) {
+      auto value = counters->read(static_cast<perf_counters::event>(e));
+      if (value)
+        std::printf(" %9.3f", static_cast<double>(*value) / ops);
+      else
+        std::printf(" %9s", "n/a");
+    }
+  }
+  std::printf("\n");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bool use_perf = false;
+  size_t n = 1'000'000;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--perf") == 0)
+      use_perf = true;
+    else
+      n = std::strtoull(argv[i], nullptr, 10);
+  }
+
+  std::optional<perf_counters> counters;
+  if (use_perf) {
+    counters.emplace();
+    if (!counters->any_available()) {
+      std::fprintf(stderr, "perf_event_open is unavailable; "
+                           "reporting timings only\n");
+      counters.reset();
+    }
+  }
+  perf_counters *pc = counters ? &*counters : nullptr;
+
+  std::mt19937_64 rng(42);
+  std::vector<int64_t> keys(n);
+  for (auto &key : keys) {
+    key = static_cast<int64_t>(rng() >> 1);
+  }
+  std::vector<int64_t> probes(n);
+  for (size_t i = 0; i < n; i++) {
+    // Half hits, half (almost certainly) misses.
+    probes[i] = i % 2 ? keys[rng() % n] : static_cast<int64_t>(rng() >> 1);
+  }
+
+  std::printf("n = %zu\n%-20s %13s %15s", n, "case", "total", "per op");
+  if (pc) {
+    for (const char *name : perf_counters::names) {
+      std::printf(" %9s", name);
+    }
+  }
+  std::printf("\n");
+
+  binary_tree_array_list<int64_t> list;
+  run_case("insert_random", n, pc, [&] {
+    for (int64_t key : keys) {
+      list.insert(key);
+    }
+  });
+
+  binary_tree_array_list<int64_t> sequential;
+  run_case("insert_sequential", n, pc, [&] {
+    for (size_t i = 0; i < n; i++) {
+      sequential.insert(static_cast<int64_t>(i));
+    }
+  });
+
+  packed_binary_tree_array_list<int64_t> packed;
+  run_case("insert_packed", n, pc, [&] {
+    for (int64_t key : keys) {
+      packed.insert(key);
+    }
+  });
+
+  bounded_binary_tree_array_list<int64_t> bounded;
+  run_case("insert_bounded", n, pc, [&] {
+    for (int64_t key : keys) {
+      bounded.insert(key);
+    }
+  });
+
+  // Each staged write moves up to b buffered items and each merge rebuilds the
+  // tree, so b around 4 sqrt(n) keeps both costs down, as in the bounded list.
+  staged_binary_tree_array_list<int64_t> staged(4 * size_t(std::sqrt(n)) + 1);
+  run_case("insert_staged", n, pc, [&] {
+    for (int64_t key : keys) {
+      staged.insert(key);
+    }
+    staged.flush();
+  });
+
+  run_case("contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (int64_t probe : probes) {
+      found += list.contains(probe);
+    }
+    sink = found;
+  });
+
+  run_case("packed_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (int64_t probe : probes) {
+      found += packed.contains(probe);
+    }
+    sink = found;
+  });
+
+  run_case("bounded_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (int64_t probe : probes) {
+      found += bounded.contains(probe);
+    }
+    sink = found;
+  });
+
+  veb_view<int64_t> veb(list);
+  run_case("veb_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (int64_t probe : probes) {
+      found += veb.contains(probe);
+    }
+    sink = found;
+  });
+
+  s_tree_view<int64_t> s_tree(list);
+  run_case("s_tree_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (int64_t probe : probes) {
+      found += s_tree.contains(probe);
+    }
+    sink = found;
+  });
+
+  compressed_view<int64_t> compressed(list);
+  run_case("compressed_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (int64_t probe : probes) {
+      found += compressed.contains(probe);
+    }
+    sink = found;
+  });
+
+  run_case("traversal", n, pc, [&] {
+    uint64_t sum = 0;
+    for (int64_t item : list) {
+      sum += static_cast<uint64_t>(item);
+    }
+    sink = sum;
+  });
+
+  binary_tree_array_list<int64_t> queue = list;
+  run_case("pop_min", n, pc, [&] {
+    uint64_t sum = 0;
+    while (auto item = queue.pop_min()) {
+      sum += static_cast<uint64_t>(*item);
+    }
+    sink = sum;
+  });
+
+  run_case("to_vector", n, pc, [&] { sink = list.to_vector(1).back(); });
+  run_case("to_vector_parallel", n, pc,
+           [&] { sink = list.to_vector(0).back(); });
+
+  run_case("reduce_parallel", n, pc, [&] {
+    sink = list.reduce(
+        uint64_t(0), [](uint64_t sum, uint64_t item) { return sum + item; },
+        0);
+  });
+
+  std::vector<int64_t> sorted = keys;
+  std::sort(sorted.begin(), sorted.end());
+  run_case("from_sorted", n, pc, [&] {
+    sink = binary_tree_array_list<int64_t>::from_sorted(sorted, 1).size();
+  });
+  run_case("from_sorted_parallel", n, pc, [&] {
+    sink = binary_tree_array_list<int64_t>::from_sorted(sorted, 0).size();
+  });
+
+  // String keys that mostly differ within their first 8 bytes, stored as
+  // std::string and behind inline prefixes.
+  std::vector<std::string> strings(n);
+  for (size_t i = 0; i < n; i++) {
+    strings[i] = std::to_string(keys[i]) + ":session";
+  }
+  binary_tree_array_list<std::string> std_strings;
+  run_case("insert_std_string", n, pc, [&] {
+    for (const auto &str : strings) {
+      std_strings.insert(str);
+    }
+  });
+  run_case("std_string_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+      found += std_strings.contains(strings[(i * 7) % n]);
+    }
+    sink = found;
+  });
+
+  string_binary_tree_array_list prefixed;
+  run_case("insert_prefixed", n, pc, [&] {
+    for (const auto &str : strings) {
+      prefixed.insert(str);
+    }
+  });
+  run_case("prefixed_contains", n, pc, [&] {
+    uint64_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+      found += prefixed.contains(strings[(i * 7) % n]);
+    }
+    sink = found;
+  });
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+// Optional hardware performance counters for the benchmark harness. Only
+// Linux's perf_event_open is supported; everywhere else (or when the kernel
+// refuses access, e.g. perf_event_paranoid or a container) every counter
+// simply reports as unavailable.
+
+#ifndef IMDAST_BENCH_PERF_COUNTERS_H
+#define IMDAST_BENCH_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace imdast::bench {
+class perf_counters {
+public:
+  enum event {
+    L1D_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+    BRANCH_MISSES,
+    INSTRUCTIONS,
+    EVENT_COUNT
+  };
+
+  static constexpr std::array<const char *, EVENT_COUNT> names = {
+      "L1D-miss", "LLC-miss", "dTLB-miss", "br-miss", "instr"};
+
+private:
+  std::array<int, EVENT_COUNT> _fds;
+
+#ifdef __linux__
+  static int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  static constexpr uint64_t cache_event(uint64_t cache, uint64_t op,
+                                        uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+  }
+#endif
+
+public:
+  // Opens every counter that the kernel allows. Counters that fail to open
+  // are left unavailable rather than failing the whole group.
+  perf_counters() noexcept {
+    _fds.fill(-1);
+#ifdef __linux__
+    _fds[L1D_MISSES] = open_event(
+        PERF_TYPE_HW_CACHE,
+        cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                    PERF_COUNT_HW_CACHE_RESULT_MISS));
+    _fds[LLC_MISSES] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    _fds[DTLB_MISSES] = open_event(
+        PERF_TYPE_HW_CACHE,
+        cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                    PERF_COUNT_HW_CACHE_RESULT_MISS));
+    _fds[BRANCH_MISSES] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    _fds[INSTRUCTIONS] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+#endif
+  }
+
+  perf_counters(const perf_counters &) = delete;
+  perf_counters &operator=(const perf_counters &) = delete;
+
+  ~perf_counters() noexcept {
+#ifdef __linux__
+    for (int fd : _fds) {
+      if (fd >= 0)
+        close(fd);
+    }
+#endif
+  }
+
+  // Returns whether at least one counter could be opened.
+  bool any_available() const noexcept {
+    for (int fd : _fds) {
+      if (fd >= 0)
+        return true;
+    }
+    return false;
+  }
+
+  // Zeroes and starts every available counter.
+  void start() noexcept {
+#ifdef __linux__
+    for (int fd : _fds) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+
+  // Stops every available counter.
+  void stop() noexcept {
+#ifdef __linux__
+    for (int fd : _fds) {
+      if (fd >= 0)
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+  }
+
+  // Returns the value of a counter since the last start(), or nullopt if that
+  // counter is unavailable.
+  std::optional<uint64_t> read(event e) const noexcept {
+#ifdef __linux__
+    uint64_t value;
+    if (_fds[e] >= 0 && ::read(_fds[e], &value, sizeof(value)) ==
+                            static_cast<ssize_t>(sizeof(value)))
+      return value;
+#endif
+    (void)e;
+    return std::nullopt;
+  }
+}; // class perf_counters
+} // namespace imdast::bench
+
+#endif // IMDAST_BENCH_PERF_COUNTERS_H
@@ -0,0 +1,140 @@
+#include "../src/binary_tree_array_list.h"
+#include "../src/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+using namespace imdast;
+
+namespace {
+// Prevents the optimizer from discarding the replayed operations' results.
+volatile uint64_t sink;
+
+constexpr const char *op_names[] = {"insert", "remove",  "contains", "find",
+                                    "at",     "iterate", "step"};
+constexpr size_t op_count = sizeof(op_names) / sizeof(op_names[0]);
+
+// Returns the latency below which the given fraction of sorted latencies lie.
+double percentile(const std::vector<double> &sorted, double fraction) {
+  size_t index = static_cast<size_t>(fraction * sorted.size());
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Prints the count, throughput and latency percentiles of one operation.
+void report(const char *name, std::vector<double> &latencies) {
+  if (latencies.empty())
+    return;
+  std::sort(latencies.begin(), latencies.end());
+  double total = 0;
+  for (double latency : latencies) {
+    total += latency;
+  }
+  std::printf("%-10s %10zu %12.0f %10.0f %10.0f %10.0f\n", name,
+              latencies.size(), latencies.size() / (total / 1e9),
+              percentile(latencies, 0.5), percentile(latencies, 0.99),
+              percentile(latencies, 0.999));
+}
+
+// Replays the trace at path on a fresh list, timing every operation.
+template <class T> void replay(const char *path) {
+  trace_reader<T> reader(path);
+  std::vector<trace_entry<T>> entries;
+  trace_entry<T> entry;
+  while (reader.next(entry)) {
+    entries.push_back(entry);
+  }
+
+  binary_tree_array_list<T> list;
+  std::vector<double> latencies[op_count];
+  std::vector<double> all;
+  all.reserve(entries.size());
+  uint64_t checksum = 0;
+  // STEP records advance the iterator of the latest ITERATE or FIND. Writes
+  // invalidate it, in which case it is created again at the same place.
+  typename binary_tree_array_list<T>::iterator cursor;
+  trace_entry<T> origin{trace_op::ITERATE, T(), 0};
+  bool stale = false;
+  for (const trace_entry<T> &op : entries) {
+    auto start = std::chrono::steady_clock::now();
+    switch (op.op) {
+    case trace_op::INSERT:
+      list.insert(op.value);
+      stale = true;
+      break;
+    case trace_op::REMOVE:
+      checksum += list.remove(op.value);
+      stale = true;
+      break;
+    case trace_op::CONTAINS:
+      checksum += list.contains(op.value);
+      break;
+    case trace_op::FIND:
+      cursor = list.find(op.value);
+      checksum += cursor.get().has_value();
+      origin = op;
+      stale = false;
+      break;
+    case trace_op::AT:
+      checksum += list.get(op.index).has_value();
+      break;
+    case trace_op::ITERATE:
+      cursor = list.begin_at(op.index);
+      origin = op;
+      stale = false;
+      break;
+    case trace_op::STEP:
+      if (stale) {
+        cursor = origin.op == trace_op::FIND ? list.find(origin.value)
+                                             : list.begin_at(origin.index);
+        stale = false;
+      }
+      for (uint64_t i = 0; i < op.index && cursor.next(); i++) {
+        checksum++;
+      }
+      break;
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    latencies[static_cast<size_t>(op.op)].push_back(ns);
+    all.push_back(ns);
+  }
+  sink = checksum;
+
+  std::printf("%-10s %10s %12s %10s %10s %10s\n", "op", "count", "ops/s",
+              "p50 ns", "p99 ns", "p999 ns");
+  for (size_t i = 0; i < op_count; i++) {
+    report(op_names[i], latencies[i]);
+  }
+  report("all", all);
+  std::printf("final size %zu, height %zu, capacity %zu\n", list.size(),
+              list.stats().height, list.capacity());
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s TRACE\n", argv[0]);
+    return 2;
+  }
+  try {
+    // Traces of 4- and 8-byte items are replayed as signed integers.
+    switch (trace_reader<int64_t>::item_size(argv[1])) {
+    case sizeof(int32_t):
+      replay<int32_t>(argv[1]);
+      break;
+    case sizeof(int64_t):
+      replay<int64_t>(argv[1]);
+      break;
+    default:
+      std::fprintf(stderr, "%s: not a trace of 4- or 8-byte items\n", argv[1]);
+      return 1;
+    }
+  } catch (const std::exception &error) {
+    std::fprintf(stderr, "%s: %s\n", argv[1], error.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,291 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_ARRAY_TREE_BASE_H
+#define IMDAST_ARRAY_TREE_BASE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#define LEFT(n) ((n) * 2 + 1)
+#define RIGHT(n) ((n) * 2 + 2)
+#define PARENT(n) (((n) - 1) / 2)
+
+namespace imdast {
+// The rotations, retracing and in-order navigation of an AVL tree stored in
+// level order, shared by the lists that keep one item per slot. A list derives
+// from array_tree_base<List>, befriends it and provides:
+//
+//   _data         one std::optional item per slot, indexable
+//   _height       the height of the subtree rooted at each slot, 0 if empty
+//   slot_count()  the number of slots
+//
+// It may hide update_height(), move_slot(), move_level() and rotated() to keep
+// state of its own in step, and full_retrace to stop retrace() from stopping
+// early. Everything here is constexpr, so a list whose storage is constexpr
+// can be built at compile time.
+template <class List> class array_tree_base {
+  constexpr List &list() noexcept { return static_cast<List &>(*this); }
+
+  constexpr const List &list() const noexcept {
+    return static_cast<const List &>(*this);
+  }
+
+protected:
+  // Whether retrace() must walk all the way up to the root, for lists whose
+  // update_height() keeps state that can change when a height does not.
+  static constexpr bool full_retrace = false;
+
+  // Height of the subtree rooted at index, treating slots past the end of the
+  // allocation as empty.
+  constexpr uint8_t height_at(size_t index) const noexcept {
+    return index < list().slot_count() ? list()._height[index] : 0;
+  }
+
+  // Recomputes the height of an occupied slot from its children.
+  constexpr void update_height(size_t index) {
+    list()._height[index] =
+        std::max(height_at(LEFT(index)), height_at(RIGHT(index))) + 1;
+  }
+
+  // Moves the item at source, and its height, into the empty slot at dest.
+  constexpr void move_slot(size_t dest, size_t source) {
+    List &self = list();
+    self._data[dest] = std::move(self._data[source]);
+    self._height[dest] = self._height[source];
+    self._data[source].reset();
+    self._height[source] = 0;
+  }
+
+  // Moves the occupied slots among the width slots starting at first to the
+  // same offsets from dest. See shift().
+  constexpr void move_level(size_t dest, size_t first, size_t width) {
+    List &self = list();
+    for (size_t i = 0; i < width && first + i < self.slot_count(); i++) {
+      if (self._data[first + i].has_value())
+        self.move_slot(dest + i, first + i);
+    }
+  }
+
+  // Called by rebalance() once it has rotated the subtree rooted at x, with
+  // the rotation it made.
+  constexpr void rotated(size_t, uint8_t) noexcept {}
+
+  // Moves the subtree rooted at current so that it becomes rooted at
+  // current + shift_amount. Each level of a subtree is a contiguous run of
+  // slots whose offset doubles per level, so the subtree is moved a level at a
+  // time: deepest first when moving down and shallowest first when moving up,
+  // so that no slot is overwritten before it has been moved out. The source
+  // and destination runs of a level never overlap, and the destination is
+  // empty wherever the source is occupied.
+  constexpr void shift(size_t current, long long shift_amount) {
+    List &self = list();
+    if (current >= self.slot_count() || !self._data[current].has_value() ||
+        shift_amount == 0)
+      return;
+
+    size_t levels = self._height[current];
+    for (size_t step = 0; step < levels; step++) {
+      size_t level = shift_amount > 0 ? levels - step - 1 : step;
+      size_t width = size_t(1) << level;
+      size_t first = (current + 1) * width - 1;
+      size_t dest = first + shift_amount * static_cast<long long>(width);
+      self.move_level(dest, first, width);
+    }
+  }
+
+  // Restores the balance of the subtree rooted at x, whose children's heights
+  // differ by 2, with a single or double rotation.
+  constexpr void rebalance(size_t x) {
+    List &self = list();
+    auto &_data = self._data;
+    auto &_height = self._height;
+
+    uint8_t rotscore = 0;
+    size_t y;
+    if (_height[LEFT(x)] > _height[RIGHT(x)]) {
+      rotscore += 0;
+      y = LEFT(x);
+    } else {
+      rotscore += 1;
+      y = RIGHT(x);
+    }
+
+    // When y is balanced (which can only happen after a removal), a single
+    // rotation is required, so ties go to the same side as y.
+    size_t z;
+    if (_height[LEFT(y)] > _height[RIGHT(y)] ||
+        (_height[LEFT(y)] == _height[RIGHT(y)] && rotscore == 0)) {
+      rotscore += 0;
+      z = LEFT(y);
+    } else {
+      rotscore += 2;
+      z = RIGHT(y);
+    }
+
+    switch (rotscore) {
+    // Rotate right
+    case 0:
+      std::swap(_data[x], _data[y]);
+      shift(RIGHT(x), RIGHT(RIGHT(x)) - RIGHT(x));
+      _data[RIGHT(x)] = std::move(_data[y]);
+      shift(RIGHT(y), 1);
+      shift(z, y - z);
+      break;
+
+    // Rotate right-left
+    case 1:
+      shift(LEFT(x), LEFT(LEFT(x)) - LEFT(x));
+      _data[LEFT(x)] = std::move(_data[x]);
+      _data[x] = std::move(_data[z]);
+      _data[z].reset();
+      _height[z] = 0;
+      shift(LEFT(z), RIGHT(LEFT(x)) - LEFT(z));
+      shift(RIGHT(z), z - RIGHT(z));
+      break;
+
+    // Rotate left-right
+    case 2:
+      shift(RIGHT(x), RIGHT(RIGHT(x)) - RIGHT(x));
+      _data[RIGHT(x)] = std::move(_data[x]);
+      _data[x] = std::move(_data[z]);
+      _data[z].reset();
+      _height[z] = 0;
+      shift(RIGHT(z), LEFT(RIGHT(x)) - RIGHT(z));
+      shift(LEFT(z), z - LEFT(z));
+      break;
+
+    // Rotate left
+    case 3:
+      std::swap(_data[x], _data[y]);
+      shift(LEFT(x), LEFT(LEFT(x)) - LEFT(x));
+      _data[LEFT(x)] = std::move(_data[y]);
+      shift(LEFT(y), -1);
+      shift(z, y - z);
+      break;
+    }
+    self.update_height(LEFT(x));
+    self.update_height(RIGHT(x));
+    self.update_height(x);
+    self.rotated(x, rotscore);
+  }
+
+  // Walks from index up to the root, fixing heights and rebalancing any
+  // ancestor that became unbalanced. Once an ancestor's height comes out
+  // unchanged, nothing above it can change either, so the walk stops there
+  // unless the list asks for a full_retrace.
+  constexpr void retrace(size_t index) {
+    List &self = list();
+    while (index > 0) {
+      index = PARENT(index);
+      uint8_t old_height = self._height[index];
+      uint8_t left = self._height[LEFT(index)];
+      uint8_t right = self._height[RIGHT(index)];
+      if (left >= right + 2 || right >= left + 2) {
+        rebalance(index);
+      }
+      self.update_height(index);
+      if constexpr (!List::full_retrace) {
+        if (self._height[index] == old_height)
+          return;
+      }
+    }
+  }
+
+  // Empties the slot at index, which must be occupied, moving its successor
+  // or, failing that, its left subtree into its place, and retraces from the
+  // slot that ends up vacated.
+  constexpr void remove_slot(size_t index) {
+    List &self = list();
+    size_t vacated = RIGHT(index);
+    if (vacated >= self.slot_count() || !self._data[vacated].has_value()) {
+      // No successor below this node, so its left subtree (if any) simply
+      // takes its place.
+      vacated = index;
+      self._data[index].reset();
+      self._height[index] = 0;
+      shift(LEFT(index), index - LEFT(index));
+    } else {
+      vacated = leftmost(vacated);
+      self._data[index] = std::move(self._data[vacated]);
+      self._data[vacated].reset();
+      self._height[vacated] = 0;
+      shift(RIGHT(vacated), vacated - RIGHT(vacated));
+    }
+
+    if (self._data[vacated].has_value())
+      self.update_height(vacated);
+    retrace(vacated);
+  }
+
+  // Returns the index of the smallest item in the subtree rooted at index.
+  constexpr size_t leftmost(size_t index) const noexcept {
+    const List &self = list();
+    while (LEFT(index) < self.slot_count() &&
+           self._data[LEFT(index)].has_value()) {
+      index = LEFT(index);
+    }
+    return index;
+  }
+
+  // Returns the index of the greatest item in the subtree rooted at index.
+  constexpr size_t rightmost(size_t index) const noexcept {
+    const List &self = list();
+    while (RIGHT(index) < self.slot_count() &&
+           self._data[RIGHT(index)].has_value()) {
+      index = RIGHT(index);
+    }
+    return index;
+  }
+
+  // Returns the index of the in-order successor of the item at index, or
+  // std::numeric_limits<size_t>::max() if it is the greatest item.
+  constexpr size_t next_index(size_t index) const noexcept {
+    const List &self = list();
+    if (RIGHT(index) < self.slot_count() && self._data[RIGHT(index)].has_value())
+      return leftmost(RIGHT(index));
+    // Climb out of every right subtree; the first ancestor reached from its
+    // left side is the successor. Duplicates make value comparisons ambiguous
+    // here, so this only looks at the indices.
+    while (index > 0 && index % 2 == 0) {
+      index = PARENT(index);
+    }
+    return index == 0 ? std::numeric_limits<size_t>::max() : PARENT(index);
+  }
+
+  // Returns the index of the in-order predecessor of the item at index, or
+  // std::numeric_limits<size_t>::max() if it is the smallest item.
+  constexpr size_t prev_index(size_t index) const noexcept {
+    const List &self = list();
+    if (LEFT(index) < self.slot_count() && self._data[LEFT(index)].has_value())
+      return rightmost(LEFT(index));
+    while (index % 2 == 1) {
+      index = PARENT(index);
+    }
+    return index == 0 ? std::numeric_limits<size_t>::max() : PARENT(index);
+  }
+}; // class array_tree_base
+} // namespace imdast
+
+#endif // IMDAST_ARRAY_TREE_BASE_H
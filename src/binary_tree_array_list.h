@@ -24,134 +24,918 @@
 #ifndef IMDAST_BINARY_TREE_ARRAY_LIST_H
 #define IMDAST_BINARY_TREE_ARRAY_LIST_H
 
+#include "array_tree_base.h"
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <new>
 #include <optional>
 #include <stack>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
-#define LEFT(n) ((n) * 2 + 1)
-#define RIGHT(n) ((n) * 2 + 2)
-#define PARENT(n) (((n) - 1) / 2)
+// Define IMDAST_BTAL_INSTRUMENT before including this header to make every
+// list keep operation counters (see binary_tree_array_list::counters()). When
+// it is not defined, the counting statements compile away entirely.
+#ifdef IMDAST_BTAL_INSTRUMENT
+#define IMDAST_BTAL_COUNT(expr) (expr)
+#else
+#define IMDAST_BTAL_COUNT(expr) ((void)0)
+#endif
+
+// Define IMDAST_BTAL_TRACE before including this header to let every list
+// report its operations to a trace_sink (see binary_tree_array_list::trace()).
+// When it is not defined, the hooks compile away entirely.
+#ifdef IMDAST_BTAL_TRACE
+#define IMDAST_BTAL_RECORD(expr) (expr)
+#else
+#define IMDAST_BTAL_RECORD(expr) ((void)0)
+#endif
 
 namespace imdast {
-template <class T> class binary_tree_array_list {
+template <class T, size_t BucketSize> class bucketed_binary_tree_array_list;
+template <class T> class combining_binary_tree_array_list;
+template <class T> class compressed_view;
+template <class T> class mapped_snapshot;
+template <class T> class replicated_binary_tree_array_list;
+template <class T> class staged_binary_tree_array_list;
+template <class T> class veb_view;
+template <class K> class interval_tree;
+
+// Operations reported to a trace_sink. ITERATE is reported when an iterator is
+// created by begin() or begin_at(), with the rank it starts at. STEP is
+// reported when an iterator created by begin(), begin_at() or find() is
+// destroyed or assigned to, with the number of items it moved past since it
+// was created, copied or last assigned to.
+enum class trace_op : uint8_t {
+  INSERT,
+  REMOVE,
+  CONTAINS,
+  FIND,
+  AT,
+  ITERATE,
+  STEP
+};
+
+// Receives the operations of lists it is attached to with
+// binary_tree_array_list::trace(). value is null for AT, ITERATE and STEP,
+// which carry a rank or a count in index instead. A sink must outlive the
+// iterators of the lists attached to it.
+template <class T> struct trace_sink {
+  virtual ~trace_sink() = default;
+  virtual void record(trace_op op, const T *value, size_t index) noexcept = 0;
+};
+
+// One of the operation counters kept when IMDAST_BTAL_INSTRUMENT is defined.
+// Const operations such as contains() count too, so threads reading the same
+// list may update it at once. Updates are relaxed atomics: totals are exact
+// once those threads are done, but imply no ordering with anything else.
+class instrumentation_counter {
+  std::atomic<uint64_t> _value;
+
+public:
+  instrumentation_counter() noexcept : _value(0) {}
+
+  instrumentation_counter(const instrumentation_counter &counter) noexcept
+      : _value(counter) {}
+
+  instrumentation_counter &
+  operator=(const instrumentation_counter &counter) noexcept {
+    _value.store(counter, std::memory_order_relaxed);
+    return *this;
+  }
+
+  void operator++(int) noexcept {
+    _value.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void operator+=(uint64_t amount) noexcept {
+    _value.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  operator uint64_t() const noexcept {
+    return _value.load(std::memory_order_relaxed);
+  }
+};
+
+// The default for binary_tree_array_list's Augment parameter: no per-slot
+// summary is kept.
+struct no_augmentation {
+  using value_type = unsigned char;
+};
+
+// Augmentations keep, beside every slot, a summary of the subtree rooted there.
+// One provides a value_type, which must be trivially copyable, and static
+// identity(), lift(item) and combine(left, right) functions. combine must be
+// associative with identity() as its neutral element; it is always applied to
+// summaries in item order, so it need not be commutative.
+
+// Sums the items of a subtree.
+template <class T> struct sum_augmentation {
+  using value_type = T;
+  static value_type identity() { return T(); }
+  static value_type lift(const T &item) { return item; }
+  static value_type combine(const value_type &left, const value_type &right) {
+    return left + right;
+  }
+};
+
+// Keeps the smallest item of a subtree.
+template <class T> struct min_augmentation {
+  using value_type = T;
+  static value_type identity() { return std::numeric_limits<T>::max(); }
+  static value_type lift(const T &item) { return item; }
+  static value_type combine(const value_type &left, const value_type &right) {
+    return std::min(left, right);
+  }
+};
+
+// Keeps the greatest item of a subtree.
+template <class T> struct max_augmentation {
+  using value_type = T;
+  static value_type identity() { return std::numeric_limits<T>::lowest(); }
+  static value_type lift(const T &item) { return item; }
+  static value_type combine(const value_type &left, const value_type &right) {
+    return std::max(left, right);
+  }
+};
+
+template <class T, class Augment = no_augmentation>
+class binary_tree_array_list
+    : public array_tree_base<binary_tree_array_list<T, Augment>> {
+  friend class array_tree_base<binary_tree_array_list>;
+  template <class, size_t> friend class bucketed_binary_tree_array_list;
+  friend class combining_binary_tree_array_list<T>;
+  friend class compressed_view<T>;
+  friend class mapped_snapshot<T>;
+  friend class replicated_binary_tree_array_list<T>;
+  friend class staged_binary_tree_array_list<T>;
+  friend class veb_view<T>;
+  template <class> friend class interval_tree;
+
+public:
+  // The per-slot summary kept by the augmentation.
+  using aggregate_type = typename Augment::value_type;
+
+private:
+  using base = array_tree_base<binary_tree_array_list>;
+  using base::height_at;
+  using base::leftmost;
+  using base::next_index;
+  using base::prev_index;
+  using base::remove_slot;
+  using base::retrace;
+  using base::rightmost;
+
+  // Whether a summary is kept for every subtree.
+  static constexpr bool augmented =
+      !std::is_same_v<Augment, no_augmentation>;
+  // Subtree summaries can change when heights do not, so they are retraced
+  // all the way up.
+  static constexpr bool full_retrace = augmented;
+  static_assert(std::is_trivially_copyable_v<aggregate_type>,
+                "Augmentation values must be trivially copyable");
+
+  // Bytes of storage per slot.
+  static constexpr size_t slot_bytes =
+      sizeof(std::optional<T>) + sizeof(uint8_t) +
+      (augmented ? sizeof(aggregate_type) : 0);
+
   std::optional<T> *_data;
   uint8_t *_height;
+  // Summary of the subtree rooted at each occupied slot, or null without an
+  // augmentation. Empty slots hold stale values that are never read.
+  aggregate_type *_aggregate;
+  // Number of lists sharing _data and _height. Copies share storage until one
+  // of them is modified, at which point that one detaches with its own copy.
+  // Null until the list first allocates.
+  std::atomic<size_t> *_refs;
   size_t _size;
   size_t _capacity;
+  // Indices of the smallest and greatest items, kept up to date by every
+  // operation that moves items. Meaningless while the list is empty.
+  size_t _min_index;
+  size_t _max_index;
+
+public:
+  // Operation counters kept when IMDAST_BTAL_INSTRUMENT is defined.
+  struct instrumentation_counters {
+    // Number of value comparisons made by searches, inserts and removes.
+    instrumentation_counter comparisons;
+    // Number of rebalance() calls, indexed by rotation case: 0 is a right
+    // rotation, 1 is right-left, 2 is left-right and 3 is a left rotation.
+    instrumentation_counter rebalances[4];
+    // Number of occupied slots moved by shift().
+    instrumentation_counter shifted_slots;
+    // Number of times the list had to grow its allocation.
+    instrumentation_counter reallocations;
+    // Total bytes requested from the allocator over the list's lifetime.
+    instrumentation_counter bytes_allocated;
+    // Number of successful insert() and remove() calls.
+    instrumentation_counter inserts;
+    instrumentation_counter removes;
+  };
+
+  // Snapshot of the list's shape and memory use, as returned by stats().
+  struct statistics {
+    size_t size;
+    size_t capacity;
+    // Height of the AVL tree; 0 when empty.
+    size_t height;
+    // Fraction of occupied slots in each allocated level, root level first.
+    std::vector<double> level_fill;
+    // Bytes currently held by the slot and height arrays.
+    size_t bytes_allocated;
+    // Bytes held by empty slots anywhere in the allocation.
+    size_t bytes_unused;
+    // Bytes held by whole levels below the tree's height, i.e. layers that
+    // were allocated by an insert and then emptied again by rebalancing.
+    size_t bytes_unused_levels;
+  };
+
+private:
+#ifdef IMDAST_BTAL_INSTRUMENT
+  mutable instrumentation_counters _counters;
+#endif
+#ifdef IMDAST_BTAL_TRACE
+  trace_sink<T> *_trace = nullptr;
+
+  // Reports an operation to the attached sink, if any.
+  void record(trace_op op, const T *value, size_t index) const noexcept {
+    if (_trace)
+      _trace->record(op, value, index);
+  }
+#endif
 
-  void shift(size_t current, long long shift_amount) {
-    if (current >= _capacity || !_data[current].has_value() ||
-        shift_amount == 0)
+  // Number of slots in the allocation.
+  size_t slot_count() const noexcept { return _capacity; }
+
+  // Moves one item, with its height and summary, for shift().
+  void move_slot(size_t dest, size_t source) {
+    base::move_slot(dest, source);
+    if constexpr (augmented)
+      _aggregate[dest] = _aggregate[source];
+    IMDAST_BTAL_COUNT(_counters.shifted_slots++);
+  }
+
+  // Moves one level of a subtree for shift(). Trivially relocatable items are
+  // copied a whole run at a time, empty slots included, since the destination
+  // is empty wherever the source is.
+  void move_level(size_t dest, size_t first, size_t width) {
+    if constexpr (trivially_relocatable) {
+      if (first >= _capacity || dest >= _capacity)
+        return;
+      size_t count = std::min({width, _capacity - first, _capacity - dest});
+      IMDAST_BTAL_COUNT(_counters.shifted_slots += std::count_if(
+                            _data + first, _data + first + count,
+                            [](const auto &slot) { return slot.has_value(); }));
+      std::memcpy(_data + dest, _data + first,
+                  count * sizeof(std::optional<T>));
+      std::memcpy(_height + dest, _height + first, count);
+      if constexpr (augmented)
+        std::memcpy(_aggregate + dest, _aggregate + first,
+                    count * sizeof(aggregate_type));
+      std::fill_n(_data + first, count, std::optional<T>());
+      std::memset(_height + first, 0, count);
+    } else {
+      base::move_level(dest, first, width);
+    }
+  }
+
+  // Whether slots can be copied, moved and discarded as raw bytes. Such lists
+  // grow with realloc() and move whole levels with memcpy(); any other type is
+  // moved one item at a time through its constructors.
+  static constexpr bool trivially_relocatable =
+      std::is_trivially_copyable_v<std::optional<T>>;
+
+  // Allocates count empty slots. Throws std::bad_alloc on failure.
+  static std::optional<T> *allocate_slots(size_t count) {
+    if (count == 0)
+      return nullptr;
+    auto *data = static_cast<std::optional<T> *>(
+        malloc(count * sizeof(std::optional<T>)));
+    if (!data)
+      throw std::bad_alloc();
+    std::uninitialized_value_construct_n(data, count);
+    return data;
+  }
+
+  // Allocates count zeroed heights. Throws std::bad_alloc on failure.
+  static uint8_t *allocate_heights(size_t count) {
+    if (count == 0)
+      return nullptr;
+    auto *height = static_cast<uint8_t *>(calloc(count, sizeof(uint8_t)));
+    if (!height)
+      throw std::bad_alloc();
+    return height;
+  }
+
+  // Allocates count uninitialized summaries, or none without an augmentation.
+  // Throws std::bad_alloc on failure.
+  static aggregate_type *allocate_aggregates(size_t count) {
+    if (!augmented || count == 0)
+      return nullptr;
+    auto *aggregate =
+        static_cast<aggregate_type *>(malloc(count * sizeof(aggregate_type)));
+    if (!aggregate)
+      throw std::bad_alloc();
+    return aggregate;
+  }
+
+  // Destroys count slots and releases their memory.
+  static void free_slots(std::optional<T> *data, size_t count) noexcept {
+    if (data)
+      std::destroy_n(data, count);
+    free(data);
+  }
+
+  // Grows the allocation to capacity slots, keeping every item at its index.
+  // The storage must not be shared. If allocating or moving an item throws,
+  // the list is left unchanged.
+  void grow(size_t capacity) {
+    if (!_refs)
+      _refs = new std::atomic<size_t>(1);
+    auto *height = static_cast<uint8_t *>(realloc(_height, capacity));
+    if (!height)
+      throw std::bad_alloc();
+    _height = height;
+    std::memset(_height + _capacity, 0, capacity - _capacity);
+    if constexpr (augmented) {
+      auto *aggregate = static_cast<aggregate_type *>(
+          realloc(_aggregate, capacity * sizeof(aggregate_type)));
+      if (!aggregate)
+        throw std::bad_alloc();
+      _aggregate = aggregate;
+    }
+
+    if constexpr (trivially_relocatable) {
+      auto *data = static_cast<std::optional<T> *>(
+          realloc(_data, capacity * sizeof(std::optional<T>)));
+      if (!data)
+        throw std::bad_alloc();
+      _data = data;
+      std::uninitialized_value_construct(_data + _capacity, _data + capacity);
+    } else {
+      std::optional<T> *data = allocate_slots(capacity);
+      try {
+        for (size_t i = 0; i < _capacity; i++) {
+          if (_data[i].has_value())
+            data[i].emplace(std::move_if_noexcept(*_data[i]));
+        }
+      } catch (...) {
+        free_slots(data, capacity);
+        throw;
+      }
+      free_slots(_data, _capacity);
+      _data = data;
+    }
+    _capacity = capacity;
+    IMDAST_BTAL_COUNT(_counters.reallocations++);
+    IMDAST_BTAL_COUNT(_counters.bytes_allocated +=
+                      _capacity * slot_bytes);
+  }
+
+  // Returns whether other lists share this list's storage, in which case it
+  // must not be modified in place.
+  bool shared() const noexcept {
+    return _refs && _refs->load(std::memory_order_acquire) > 1;
+  }
+
+  // Drops this list's reference to its storage, freeing it if no other list
+  // shares it, and leaves the list empty with no allocation.
+  void release() noexcept {
+    if (_refs && _refs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      free_slots(_data, _capacity);
+      free(_height);
+      free(_aggregate);
+      delete _refs;
+    }
+    _data = nullptr;
+    _height = nullptr;
+    _aggregate = nullptr;
+    _refs = nullptr;
+    _size = 0;
+    _capacity = 0;
+  }
+
+  // Replaces this list's storage with capacity empty slots that it does not
+  // share. If allocating throws, the list is left unchanged.
+  void reallocate(size_t capacity) {
+    std::unique_ptr<std::atomic<size_t>> refs(new std::atomic<size_t>(1));
+    std::unique_ptr<aggregate_type, decltype(&free)> aggregate(
+        allocate_aggregates(capacity), &free);
+    uint8_t *height = allocate_heights(capacity);
+    std::optional<T> *data;
+    try {
+      data = allocate_slots(capacity);
+    } catch (...) {
+      free(height);
+      throw;
+    }
+    release();
+    _data = data;
+    _height = height;
+    _aggregate = aggregate.release();
+    _refs = refs.release();
+    _capacity = capacity;
+    IMDAST_BTAL_COUNT(_counters.reallocations++);
+    IMDAST_BTAL_COUNT(_counters.bytes_allocated +=
+                      _capacity * slot_bytes);
+  }
+
+  // Gives this list its own copy of storage that it shares with other lists,
+  // so that it can be modified. Only the levels the tree occupies are copied;
+  // every item keeps its index. If allocating or copying an item throws, the
+  // list is left unchanged.
+  void detach() {
+    if (!shared())
       return;
 
-    if (shift_amount > 0) {
-      shift(LEFT(current), shift_amount * 2);
-      shift(RIGHT(current), shift_amount * 2);
+    size_t used = (size_t(1) << (_size ? _height[0] : 0)) - 1;
+    std::unique_ptr<std::atomic<size_t>> refs(new std::atomic<size_t>(1));
+    std::unique_ptr<aggregate_type, decltype(&free)> aggregate(
+        allocate_aggregates(used), &free);
+    uint8_t *height = allocate_heights(used);
+    std::optional<T> *data;
+    try {
+      data = allocate_slots(used);
+      try {
+        std::copy_n(_data, used, data);
+      } catch (...) {
+        free_slots(data, used);
+        throw;
+      }
+    } catch (...) {
+      free(height);
+      throw;
     }
+    if (used)
+      std::memcpy(height, _height, used);
+    if (aggregate)
+      std::memcpy(aggregate.get(), _aggregate, used * sizeof(aggregate_type));
 
-    _data[current + shift_amount] = std::move(_data[current]);
-    _height[current + shift_amount] = std::move(_height[current]);
-    _data[current].reset();
-    _height[current] = 0;
+    size_t size = _size;
+    release();
+    _data = data;
+    _height = height;
+    _aggregate = aggregate.release();
+    _refs = refs.release();
+    _size = size;
+    _capacity = used;
+    IMDAST_BTAL_COUNT(_counters.bytes_allocated +=
+                      _capacity * slot_bytes);
+  }
 
-    if (shift_amount < 0) {
-      shift(LEFT(current), shift_amount * 2);
-      shift(RIGHT(current), shift_amount * 2);
+  // Returns whether the slot at index holds an item.
+  bool occupied(size_t index) const noexcept {
+    return index < _capacity && _data[index].has_value();
+  }
+
+  // Whether index is on the left spine (2^d - 1), i.e. is the smallest item or
+  // one of its ancestors.
+  static bool on_left_spine(size_t index) noexcept {
+    return (index & (index + 1)) == 0;
+  }
+
+  // Whether index is on the right spine (2^(d+1) - 2), i.e. is the greatest
+  // item or one of its ancestors.
+  static bool on_right_spine(size_t index) noexcept {
+    return ((index + 1) & (index + 2)) == 0;
+  }
+
+  // Counts a rotation made by rebalance() at x. A rotation only moves items
+  // within x's subtree, so the smallest or greatest item can only have moved
+  // if x is on its spine, and is then found again below x.
+  void rotated(size_t x, [[maybe_unused]] uint8_t rotation) noexcept {
+    IMDAST_BTAL_COUNT(_counters.rebalances[rotation]++);
+    if (on_left_spine(x))
+      _min_index = leftmost(x);
+    if (on_right_spine(x))
+      _max_index = rightmost(x);
+  }
+
+  // Summary of the subtree rooted at index, treating empty slots and slots past
+  // the end of the allocation as empty subtrees.
+  aggregate_type aggregate_at(size_t index) const {
+    if (index < _capacity && _data[index].has_value())
+      return _aggregate[index];
+    return Augment::identity();
+  }
+
+  // Recomputes the height, and summary if any, of an occupied slot from its
+  // children.
+  void update_height(size_t index) {
+    _height[index] =
+        std::max(height_at(LEFT(index)), height_at(RIGHT(index))) + 1;
+    if constexpr (augmented)
+      _aggregate[index] = Augment::combine(
+          Augment::combine(aggregate_at(LEFT(index)),
+                           Augment::lift(*_data[index])),
+          aggregate_at(RIGHT(index)));
+  }
+
+  // Updates the indices of the smallest and greatest items for the removal of
+  // the item at index, before remove_slot() makes it. Without rotations, the
+  // removal moves a spine by at most one level; rotations made while
+  // retracing are handled by rotated().
+  void remove_extremes(size_t index) noexcept {
+    if (_size == 1)
+      return;
+    if (index == _min_index) {
+      // Its right child, if any, is a leaf that takes its slot.
+      if (!occupied(RIGHT(index)))
+        _min_index = PARENT(index);
+    } else if (on_left_spine(index) && !occupied(RIGHT(index))) {
+      // The left subtree, and the spine with it, moves up a level.
+      _min_index = PARENT(_min_index);
+    }
+    if (index == _max_index) {
+      // Its left child, if any, is a leaf that takes its slot.
+      if (!occupied(LEFT(index)))
+        _max_index = PARENT(index);
+    } else if (on_right_spine(index) && !occupied(LEFT(RIGHT(index)))) {
+      // The successor is the right child, and its right subtree, with the
+      // rest of the spine, moves up a level.
+      _max_index = PARENT(_max_index);
     }
   }
 
-  void deep_copy(const binary_tree_array_list<T> &list) {
-    this->_size = list._size;
-    this->_capacity = list._capacity;
-    this->_data = static_cast<std::optional<T> *>(
-        malloc(list._capacity * sizeof(std::optional<T>)));
-    std::memcpy(this->_data, list._data,
-                list._capacity * sizeof(std::optional<T>));
-    this->_height =
-        static_cast<uint8_t *>(malloc(list._capacity * sizeof(uint8_t)));
-    std::memcpy(this->_height, list._height, list._capacity * sizeof(uint8_t));
+  // Removes the item stored at index, which must be occupied.
+  void remove_at(size_t index) {
+    detach();
+    remove_extremes(index);
+    remove_slot(index);
+    _size--;
+    IMDAST_BTAL_COUNT(_counters.removes++);
   }
 
-  void rebalance(size_t x) {
-    uint8_t rotscore = 0;
-    size_t y;
-    if (_height[LEFT(x)] > _height[RIGHT(x)]) {
-      rotscore += 0;
-      y = LEFT(x);
+  // Finds the smallest and greatest items again after the tree has been laid
+  // out anew. They are at the ends of the left and right spines, so this is
+  // two walks from the root.
+  void refresh_extremes() noexcept {
+    if (_size == 0)
+      return;
+    _min_index = leftmost(0);
+    _max_index = rightmost(0);
+  }
+
+  // Places value in the empty slot at index, which must keep the items in
+  // order, growing the allocation if the slot is past its end, and rebalances.
+  void insert_at(size_t index, const T &value) {
+    IMDAST_BTAL_RECORD(record(trace_op::INSERT, &value, 0));
+    while (index >= _capacity) {
+      grow(LEFT(_capacity));
+    }
+    _data[index].emplace(value);
+    _size++;
+    // A new leaf is the smallest item only as the left child of the previous
+    // smallest, and likewise for the greatest, so appends move the cached
+    // indices down a level. Rotations while retracing are handled by
+    // rotated().
+    if (_size == 1) {
+      _min_index = index;
+      _max_index = index;
     } else {
-      rotscore += 1;
-      y = RIGHT(x);
+      if (index == LEFT(_min_index))
+        _min_index = index;
+      if (index == RIGHT(_max_index))
+        _max_index = index;
     }
+    update_height(index);
+    retrace(index);
+    IMDAST_BTAL_COUNT(_counters.inserts++);
+  }
+
+  // Removes the item at index and returns it, moving it out unless the storage
+  // is shared.
+  std::optional<T> pop_at(size_t index) {
+    IMDAST_BTAL_RECORD(record(trace_op::REMOVE, &*_data[index], 0));
+    detach();
+    std::optional<T> item = std::move(_data[index]);
+    remove_at(index);
+    return item;
+  }
+
+  // Returns whether moving k items one at a time (O(k log n)) is expected to
+  // be cheaper than relaying out all n items.
+  static bool few_enough(size_t k, size_t n) noexcept {
+    size_t levels = 0;
+    for (size_t i = n; i > 0; i /= 2) {
+      levels++;
+    }
+    return k * levels < n;
+  }
+
+  // Below this many items or slots per thread, work is not split further.
+  static constexpr size_t parallel_grain = size_t(1) << 15;
+
+  // Resolves a requested thread count, where 0 means one per core.
+  static unsigned resolve_threads(unsigned threads) noexcept {
+    if (threads == 0)
+      threads = std::thread::hardware_concurrency();
+    return std::max(threads, 1u);
+  }
+
+  // Runs first on this thread and second on a new one, then rethrows the
+  // exception either of them threw, if any. If no thread can be started, both
+  // run here.
+  template <class F, class G>
+  static void parallel_invoke(const F &first, const G &second) {
+    std::exception_ptr error;
+    {
+      std::jthread worker;
+      try {
+        worker = std::jthread([&] {
+          try {
+            second();
+          } catch (...) {
+            error = std::current_exception();
+          }
+        });
+      } catch (const std::system_error &) {
+        second();
+      }
+      first();
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  // Calls body(begin, end) on disjoint ranges covering [begin, end), halving
+  // the range across up to threads threads while each half has at least grain
+  // elements.
+  template <class F>
+  static void parallel_ranges(size_t begin, size_t end, unsigned threads,
+                              const F &body, size_t grain = parallel_grain) {
+    if (threads <= 1 || end - begin < 2 * grain) {
+      body(begin, end);
+      return;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    parallel_invoke(
+        [&] {
+          parallel_ranges(begin, middle, threads - threads / 2, body, grain);
+        },
+        [&] { parallel_ranges(middle, end, threads / 2, body, grain); });
+  }
+
+  // A piece of the in-order sequence: either the single item at index, or the
+  // count items of the subtree rooted at index. offset is its position in the
+  // sequence.
+  struct export_part {
+    size_t index;
+    bool subtree;
+    size_t count;
+    size_t offset;
+  };
 
-    size_t z;
-    if (_height[LEFT(y)] > _height[RIGHT(y)]) {
-      rotscore += 0;
-      z = LEFT(y);
+  // Lists, in order, the items above depth and the subtrees rooted at depth.
+  void collect_parts(size_t index, size_t level, size_t depth,
+                     std::vector<export_part> &parts) const {
+    if (index >= _capacity || !_data[index].has_value())
+      return;
+    if (level == depth) {
+      parts.push_back({index, true, 0, 0});
+      return;
+    }
+    collect_parts(LEFT(index), level + 1, depth, parts);
+    parts.push_back({index, false, 1, 0});
+    collect_parts(RIGHT(index), level + 1, depth, parts);
+  }
+
+  // Counts the items in the subtree rooted at index by scanning its levels,
+  // each of which is a contiguous run of slots.
+  size_t subtree_size(size_t index) const noexcept {
+    size_t count = 0;
+    for (size_t level = 0; level < _height[index]; level++) {
+      size_t width = size_t(1) << level;
+      size_t first = (index + 1) * width - 1;
+      size_t last = std::min(first + width, _capacity);
+      for (size_t i = first; i < last; i++) {
+        count += _data[i].has_value();
+      }
+    }
+    return count;
+  }
+
+  // Copies the items in order to out, with the tree split into at least two
+  // subtrees per thread. The subtrees are counted and then copied in parallel,
+  // each into its own part of the output.
+  template <class OutputIt>
+  void copy_to_parallel(OutputIt out, unsigned threads) const {
+    size_t depth = 0;
+    while ((size_t(1) << depth) < 2 * size_t(threads)) {
+      depth++;
+    }
+    std::vector<export_part> parts;
+    collect_parts(0, 0, depth, parts);
+
+    parallel_ranges(
+        0, parts.size(), threads,
+        [&](size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            if (parts[p].subtree)
+              parts[p].count = subtree_size(parts[p].index);
+          }
+        },
+        1);
+    size_t offset = 0;
+    for (export_part &part : parts) {
+      part.offset = offset;
+      offset += part.count;
+    }
+    parallel_ranges(
+        0, parts.size(), threads,
+        [&](size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            OutputIt dest = out + parts[p].offset;
+            size_t index = parts[p].subtree ? leftmost(parts[p].index)
+                                            : parts[p].index;
+            for (size_t k = 0; k < parts[p].count; k++) {
+              *dest++ = *_data[index];
+              index = next_index(index);
+            }
+          }
+        },
+        1);
+  }
+
+  // Replaces the contents of the list with the given items, which must already
+  // be in order, laid out as a perfectly balanced tree. The allocation is only
+  // replaced if it is too small or shared. Runs in O(capacity + n), split
+  // across up to threads threads.
+  void assign_sorted(std::vector<T> &&sorted, unsigned threads = 1) {
+    size_t required = 0;
+    while (required < sorted.size()) {
+      required = LEFT(required);
+    }
+    if (required > _capacity || shared()) {
+      reallocate(required);
+    } else {
+      parallel_ranges(0, _capacity, threads, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          _data[i].reset();
+          _height[i] = 0;
+        }
+      });
+    }
+    _size = sorted.size();
+    build_sorted(0, sorted.data(), sorted.size(), threads);
+    refresh_extremes();
+  }
+
+  // Places the middle of items at index and recurses into both halves.
+  // Returns the height of the subtree that was built. The two subtrees occupy
+  // disjoint slots, so they are built on separate threads while threads
+  // allows.
+  uint8_t build_sorted(size_t index, T *items, size_t count,
+                       unsigned threads = 1) {
+    if (count == 0)
+      return 0;
+    size_t middle = count / 2;
+    _data[index] = std::move(items[middle]);
+    uint8_t left, right;
+    if (threads <= 1 || count < 2 * parallel_grain) {
+      left = build_sorted(LEFT(index), items, middle);
+      right =
+          build_sorted(RIGHT(index), items + middle + 1, count - middle - 1);
     } else {
-      rotscore += 2;
-      z = RIGHT(y);
-    }
-
-    switch (rotscore) {
-    // Rotate right
-    case 0:
-      std::swap(_data[x], _data[y]);
-      shift(RIGHT(x), RIGHT(RIGHT(x)) - RIGHT(x));
-      _data[RIGHT(x)] = std::move(_data[y]);
-      shift(RIGHT(y), 1);
-      shift(z, y - z);
-      break;
-
-    // Rotate right-left
-    case 1:
-      shift(LEFT(x), LEFT(LEFT(x)) - LEFT(x));
-      _data[LEFT(x)] = std::move(_data[x]);
-      _data[x] = std::move(_data[z]);
-      _data[z].reset();
-      _height[z] = 0;
-      shift(LEFT(z), RIGHT(LEFT(x)) - LEFT(z));
-      shift(RIGHT(z), z - RIGHT(z));
-      break;
-
-    // Rotate left-right
-    case 2:
-      shift(RIGHT(x), RIGHT(RIGHT(x)) - RIGHT(x));
-      _data[RIGHT(x)] = std::move(_data[x]);
-      _data[x] = std::move(_data[z]);
-      _data[z].reset();
-      _height[z] = 0;
-      shift(RIGHT(z), LEFT(RIGHT(x)) - RIGHT(z));
-      shift(LEFT(z), z - LEFT(z));
-      break;
-
-    // Rotate left
-    case 3:
-      std::swap(_data[x], _data[y]);
-      shift(LEFT(x), LEFT(LEFT(x)) - LEFT(x));
-      _data[LEFT(x)] = std::move(_data[y]);
-      shift(LEFT(y), -1);
-      shift(z, y - z);
-      break;
-    }
-    _height[LEFT(x)] =
-        std::max(_height[LEFT(LEFT(x))], _height[RIGHT(LEFT(x))]) + 1;
-    _height[RIGHT(x)] =
-        std::max(_height[LEFT(RIGHT(x))], _height[RIGHT(RIGHT(x))]) + 1;
-    _height[x] = std::max(_height[RIGHT(x)], _height[LEFT(x)]) + 1;
+      parallel_invoke(
+          [&] {
+            left = build_sorted(LEFT(index), items, middle,
+                                threads - threads / 2);
+          },
+          [&] {
+            right = build_sorted(RIGHT(index), items + middle + 1,
+                                 count - middle - 1, threads / 2);
+          });
+    }
+    update_height(index);
+    return _height[index];
+  }
+
+  // Reduces the items in slots [begin, end), halving the range across up to
+  // threads threads. See reduce().
+  template <class U, class Op>
+  U reduce_range(size_t begin, size_t end, unsigned threads,
+                 const U &identity, const Op &op) const {
+    if (threads <= 1 || end - begin < 2 * parallel_grain) {
+      U result = identity;
+      for (size_t i = begin; i < end; i++) {
+        if (_data[i].has_value())
+          result = op(std::move(result), *_data[i]);
+      }
+      return result;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    std::optional<U> left, right;
+    parallel_invoke(
+        [&] {
+          left = reduce_range(begin, middle, threads - threads / 2, identity,
+                              op);
+        },
+        [&] {
+          right = reduce_range(middle, end, threads / 2, identity, op);
+        });
+    return op(std::move(*left), std::move(*right));
+  }
+
+  // Summarizes the items of the subtree rooted at index that are not less
+  // than lo (unless lo is null) and less than hi (unless hi is null). Once a
+  // node falls inside the range, each of its subtrees is bounded on one side
+  // only, so at most two paths from the root are followed.
+  aggregate_type aggregate_range(size_t index, const T *lo, const T *hi) const {
+    if (index >= _capacity || !_data[index].has_value())
+      return Augment::identity();
+    if (!lo && !hi)
+      return _aggregate[index];
+    const T &item = *_data[index];
+    IMDAST_BTAL_COUNT(_counters.comparisons++);
+    if (lo && item < *lo)
+      return aggregate_range(RIGHT(index), lo, hi);
+    IMDAST_BTAL_COUNT(_counters.comparisons++);
+    if (hi && !(item < *hi))
+      return aggregate_range(LEFT(index), lo, hi);
+    return Augment::combine(
+        Augment::combine(aggregate_range(LEFT(index), lo, nullptr),
+                         Augment::lift(item)),
+        aggregate_range(RIGHT(index), nullptr, hi));
+  }
+
+  enum class set_operation { UNION, INTERSECTION, DIFFERENCE };
+
+  // Walks this list and other in order at the same time and collects the
+  // result of a set operation. Duplicates follow the same rules as
+  // std::set_union, std::set_intersection and std::set_difference.
+  std::vector<T> combine(const binary_tree_array_list &other,
+                         set_operation operation) const {
+    constexpr size_t end = std::numeric_limits<size_t>::max();
+    std::vector<T> result;
+    result.reserve(operation == set_operation::UNION ? _size + other._size
+                                                     : _size);
+    size_t a = _size ? leftmost(0) : end;
+    size_t b = other._size ? other.leftmost(0) : end;
+    while (a != end && b != end) {
+      const T &left = _data[a].value();
+      const T &right = other._data[b].value();
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (left < right) {
+        if (operation != set_operation::INTERSECTION)
+          result.push_back(left);
+        a = next_index(a);
+        continue;
+      }
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (right < left) {
+        if (operation == set_operation::UNION)
+          result.push_back(right);
+        b = other.next_index(b);
+        continue;
+      }
+      if (operation != set_operation::DIFFERENCE)
+        result.push_back(left);
+      a = next_index(a);
+      b = other.next_index(b);
+    }
+    for (; a != end && operation != set_operation::INTERSECTION;
+         a = next_index(a)) {
+      result.push_back(_data[a].value());
+    }
+    for (; b != end && operation == set_operation::UNION;
+         b = other.next_index(b)) {
+      result.push_back(other._data[b].value());
+    }
+    return result;
   }
 
 public:
   class iterator {
-    const binary_tree_array_list<T> *_list;
+    friend class binary_tree_array_list;
+
+    const binary_tree_array_list *_list;
     size_t _current;
+#ifdef IMDAST_BTAL_TRACE
+    trace_sink<T> *_trace = nullptr;
+    size_t _steps = 0;
+
+    // Reports the steps taken so far to the sink, if any.
+    void report_steps() noexcept {
+      if (_trace && _steps)
+        _trace->record(trace_op::STEP, nullptr, _steps);
+      _steps = 0;
+    }
+#endif
 
     void construct_at_zero() noexcept {
       if (_list->_size == 0) {
@@ -170,7 +954,7 @@ public:
     // Parameters are reversed compared to how I usually put them in order to
     // disambiguate the iterator. It's ugly, but works well enough for a private
     // API.
-    iterator(size_t current, const binary_tree_array_list<T> *list)
+    iterator(size_t current, const binary_tree_array_list *list)
         : _list(list), _current(current) {}
 
   public:
@@ -179,14 +963,14 @@ public:
         : _list(nullptr), _current(std::numeric_limits<size_t>::max()) {}
 
     // Creates an iterator pointing to the smallest item in the list.
-    iterator(const binary_tree_array_list<T> *list) noexcept : _list(list) {
+    iterator(const binary_tree_array_list *list) noexcept : _list(list) {
       construct_at_zero();
     }
 
     // Creates an iterator pointing to the nth (0-indexed) smallest item in the
     // list. If index is >= list->size(), then the iterator will point to the
     // greatest item in the list.
-    iterator(const binary_tree_array_list<T> *list, size_t index) noexcept
+    iterator(const binary_tree_array_list *list, size_t index) noexcept
         : _list(list) {
       construct_at_zero();
       for (size_t i = 0; i < index; i++) {
@@ -196,19 +980,27 @@ public:
 
     // Performs a shallow copy of the iterator. The copy will act independently
     // from the original iterator.
-    iterator(const binary_tree_array_list<T>::iterator &iter) noexcept
-        : _list(iter._list), _current(iter._current) {}
+    iterator(const binary_tree_array_list::iterator &iter) noexcept
+        : _list(iter._list), _current(iter._current) {
+      IMDAST_BTAL_RECORD(_trace = iter._trace);
+    }
+
+#ifdef IMDAST_BTAL_TRACE
+    ~iterator() noexcept { report_steps(); }
+#endif
 
     // Searches for the item, then constructs an iterator starting at that item.
     // If the list does not contain the item, then the iterator will start at
     // the past-the-last element.
-    static iterator find(const binary_tree_array_list<T> *list,
+    static iterator find(const binary_tree_array_list *list,
                          const T &item) noexcept {
       size_t current = 0;
       while (current < list->_capacity && list->_data[current].has_value()) {
+        IMDAST_BTAL_COUNT(list->_counters.comparisons++);
         if (item == list->_data[current].value()) {
           return iterator(current, list);
         }
+        IMDAST_BTAL_COUNT(list->_counters.comparisons++);
         current = item < list->_data[current].value() ? LEFT(current)
                                                       : RIGHT(current);
       }
@@ -238,12 +1030,10 @@ public:
       if (LEFT(_current) < _list->_capacity &&
           _list->_data[LEFT(_current)].has_value())
         return true;
-      size_t index = _current;
-      while (index > 0) {
-        if (_list->_data[PARENT(index)].value() <
-            _list->_data[_current].value())
+      // A predecessor exists above if this node is in some right subtree.
+      for (size_t index = _current; index > 0; index = PARENT(index)) {
+        if (index % 2 == 0)
           return true;
-        index = PARENT(index);
       }
       return false;
     }
@@ -253,27 +1043,8 @@ public:
     bool next() noexcept {
       if (!_list || _current == std::numeric_limits<size_t>::max())
         return false;
-      size_t offset = _current;
-      if (RIGHT(offset) >= _list->_capacity ||
-          !_list->_data[RIGHT(offset)].has_value()) {
-        T value = _list->_data[_current].value();
-        size_t parent = offset;
-        do {
-          if (parent == 0) {
-            _current = std::numeric_limits<size_t>::max();
-            return true;
-          }
-          parent = PARENT(parent);
-        } while (_list->_data[parent].value() < value);
-        _current = parent;
-        return true;
-      }
-      offset = RIGHT(offset);
-      while (LEFT(offset) < _list->_capacity &&
-             _list->_data[LEFT(offset)].has_value()) {
-        offset = LEFT(offset);
-      }
-      _current = offset;
+      _current = _list->next_index(_current);
+      IMDAST_BTAL_RECORD(_steps++);
       return true;
     }
 
@@ -300,21 +1071,18 @@ public:
                _list->_data[RIGHT(_current)].has_value()) {
           _current = RIGHT(_current);
         }
+        IMDAST_BTAL_RECORD(_steps++);
         return true;
       }
       size_t offset = _current;
       if (LEFT(offset) >= _list->_capacity ||
           !_list->_data[LEFT(offset)].has_value()) {
-        T value = _list->_data[_current].value();
-        size_t parent = offset;
-        do {
-          if (parent == 0) {
-            _current = std::numeric_limits<size_t>::max();
-            return true;
-          }
-          parent = PARENT(parent);
-        } while (_list->_data[parent].value() > value);
-        _current = parent;
+        while (offset % 2 == 1) {
+          offset = PARENT(offset);
+        }
+        _current =
+            offset == 0 ? std::numeric_limits<size_t>::max() : PARENT(offset);
+        IMDAST_BTAL_RECORD(_steps++);
         return true;
       }
       offset = LEFT(offset);
@@ -323,6 +1091,7 @@ public:
         offset = RIGHT(offset);
       }
       _current = offset;
+      IMDAST_BTAL_RECORD(_steps++);
       return true;
     }
 
@@ -354,28 +1123,59 @@ public:
     }
 
     // Shallow-copies the right iterator into the left.
-    binary_tree_array_list<T>::iterator &
-    operator=(const binary_tree_array_list<T>::iterator &right) {
+    binary_tree_array_list::iterator &
+    operator=(const binary_tree_array_list::iterator &right) {
+      IMDAST_BTAL_RECORD(report_steps());
+      IMDAST_BTAL_RECORD(this->_trace = right._trace);
       this->_list = right._list;
       this->_current = right._current;
       return *this;
     }
   }; // class iterator
 
+#ifdef IMDAST_BTAL_TRACE
+private:
+  // Makes iter report the steps it takes from here on to the attached sink.
+  void trace_steps(iterator &iter) const noexcept {
+    iter._trace = _trace;
+    iter._steps = 0;
+  }
+
+public:
+#endif
+
   // Creates an empty binary tree array list.
   binary_tree_array_list() noexcept
-      : _data(nullptr), _height(nullptr), _size(0), _capacity(0) {}
+      : _data(nullptr), _height(nullptr), _aggregate(nullptr), _refs(nullptr),
+        _size(0), _capacity(0), _min_index(0), _max_index(0) {}
 
-  // Creates a deep copy of the list.
-  binary_tree_array_list(const binary_tree_array_list<T> &list) noexcept {
-    deep_copy(list);
+  // Creates a copy of the list in O(1). The two lists share storage until
+  // either is modified, which then copies the occupied levels first.
+  binary_tree_array_list(const binary_tree_array_list &list) noexcept
+      : _data(list._data), _height(list._height),
+        _aggregate(list._aggregate), _refs(list._refs), _size(list._size),
+        _capacity(list._capacity), _min_index(list._min_index),
+        _max_index(list._max_index) {
+    if (_refs)
+      _refs->fetch_add(1, std::memory_order_relaxed);
   }
 
-  ~binary_tree_array_list() noexcept {
-    free(_data);
-    free(_height);
+  // Takes over the allocation of another list, leaving that list empty.
+  binary_tree_array_list(binary_tree_array_list &&list) noexcept
+      : _data(list._data), _height(list._height),
+        _aggregate(list._aggregate), _refs(list._refs), _size(list._size),
+        _capacity(list._capacity), _min_index(list._min_index),
+        _max_index(list._max_index) {
+    list._data = nullptr;
+    list._height = nullptr;
+    list._aggregate = nullptr;
+    list._refs = nullptr;
+    list._size = 0;
+    list._capacity = 0;
   }
 
+  ~binary_tree_array_list() noexcept { release(); }
+
   // Returns the number of items in the list.
   size_t size() const noexcept { return _size; }
 
@@ -386,100 +1186,161 @@ public:
   // Returns if the list is empty.
   bool empty() const noexcept { return !_size; }
 
-  // Removes all items from the list. Does not shrink the list's allocation.
-  void clear() {
-    free(_data);
-    free(_height);
-    _data = static_cast<std::optional<T> *>(
-        malloc(_capacity * sizeof(std::optional<T>)));
+  // Reports the height of the tree, how full each level is and how many bytes
+  // are spent on empty slots. Runs in O(capacity).
+  statistics stats() const {
+    statistics result;
+    result.size = _size;
+    result.capacity = _capacity;
+    result.height = _capacity ? _height[0] : 0;
+    result.bytes_allocated = _capacity * slot_bytes;
+    result.bytes_unused = (_capacity - _size) * slot_bytes;
+    result.bytes_unused_levels = 0;
+    for (size_t first = 0, width = 1; first < _capacity;
+         first = LEFT(first), width *= 2) {
+      size_t occupied = 0;
+      for (size_t i = first; i < first + width; i++) {
+        occupied += _data[i].has_value();
+      }
+      result.level_fill.push_back(static_cast<double>(occupied) / width);
+      if (result.level_fill.size() > result.height)
+        result.bytes_unused_levels += width * slot_bytes;
+    }
+    return result;
+  }
+
+#ifdef IMDAST_BTAL_INSTRUMENT
+  // Returns the operation counters accumulated since construction or the last
+  // call to reset_counters(). They may be read while other threads read the
+  // list, but reset_counters() must not race with any other call.
+  const instrumentation_counters &counters() const noexcept {
+    return _counters;
+  }
+
+  // Zeroes the operation counters.
+  void reset_counters() noexcept { _counters = instrumentation_counters(); }
+#endif
+
+#ifdef IMDAST_BTAL_TRACE
+  // Reports every later insert, remove, contains(), find(), operator[] and
+  // begin() or begin_at() call to sink, or stops reporting if sink is null.
+  // Copies of the list start without a sink.
+  void trace(trace_sink<T> *sink) noexcept { _trace = sink; }
+#endif
+
+  // Removes all items from the list. Does not shrink the list's allocation,
+  // unless it is shared with other lists, in which case it is let go of.
+  void clear() noexcept {
+    if (shared()) {
+      release();
+      return;
+    }
     for (size_t i = 0; i < _capacity; i++) {
-      _data[i] = std::optional<T>();
+      _data[i].reset();
     }
-    _height = static_cast<uint8_t *>(calloc(_capacity, sizeof(uint8_t)));
+    if (_capacity)
+      std::memset(_height, 0, _capacity);
     _size = 0;
   }
 
   // Inserts a value into the list in-order.
+  // A value not less than the greatest item goes straight below it on the
+  // right spine, and one less than the smallest below it on the left spine,
+  // without descending from the root.
   void insert(const T &value) {
-    size_t index = 0;
-    while (true) {
-      if (index >= _capacity) {
-        size_t old_capacity = _capacity;
-        _capacity = LEFT(_capacity);
-        _data = static_cast<std::optional<T> *>(
-            realloc(_data, _capacity * sizeof(std::optional<T>)));
-        _height = static_cast<uint8_t *>(
-            realloc(_height, _capacity * sizeof(uint8_t)));
-        for (size_t i = old_capacity; i < _capacity; i++) {
-          _data[i] = std::optional<T>();
-          _height[i] = 0;
-        }
+    detach();
+    if (_size > 0) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (!(value < *_data[_max_index])) {
+        insert_at(RIGHT(_max_index), value);
+        return;
       }
-      if (!_data[index].has_value()) {
-        _data[index] = std::make_optional(value);
-        _size++;
-        break;
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (value < *_data[_min_index]) {
+        insert_at(LEFT(_min_index), value);
+        return;
       }
+    }
+
+    size_t index = 0;
+    while (index < _capacity && _data[index].has_value()) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
       index = LEFT(index) + (_data[index].value() < value);
     }
+    insert_at(index, value);
+  }
 
-    _height[index] = 1;
-    while (index > 0) {
-      index = PARENT(index);
-      if (std::abs(_height[RIGHT(index)] - _height[LEFT(index)]) >= 2) {
-        rebalance(index);
+  // Inserts a value just before the item hint points to (or after the
+  // greatest item, if hint is past-the-last), without searching, if that
+  // keeps the list in order. Otherwise, inserts it as insert(value) does.
+  void insert(const iterator &hint, const T &value) {
+    detach();
+    size_t next = hint._list == this ? hint._current
+                                     : std::numeric_limits<size_t>::max();
+    if (next == std::numeric_limits<size_t>::max() ||
+        next >= _capacity || !_data[next].has_value()) {
+      insert(value);
+      return;
+    }
+    IMDAST_BTAL_COUNT(_counters.comparisons++);
+    if (*_data[next] < value) {
+      insert(value);
+      return;
+    }
+    size_t prev = prev_index(next);
+    if (prev != std::numeric_limits<size_t>::max()) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (value < *_data[prev]) {
+        insert(value);
+        return;
       }
-      _height[index] =
-          std::max(_height[LEFT(index)], _height[RIGHT(index)]) + 1;
     }
+
+    // The empty slot between prev and next in order is either next's left
+    // child or, if next has one, the right child of prev.
+    if (LEFT(next) < _capacity && _data[LEFT(next)].has_value())
+      insert_at(RIGHT(prev), value);
+    else
+      insert_at(LEFT(next), value);
   }
 
   // Removes an item from the list, returning whether said item was in the list.
   bool remove(const T &value) {
+    IMDAST_BTAL_RECORD(record(trace_op::REMOVE, &value, 0));
     size_t index = 0;
     while (index < _capacity && _data[index].has_value()) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
       if (_data[index].value() == value) {
-        goto found;
+        remove_at(index);
+        return true;
       }
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
       index = value < _data[index] ? LEFT(index) : RIGHT(index);
     }
     return false;
+  }
 
-  found:
-    size_t next = RIGHT(index);
-    if (next >= _capacity || !_data[next].has_value()) {
-      _data[index].reset();
-    } else {
-      while (LEFT(next) < _capacity && _data[LEFT(next)].has_value()) {
-        next = LEFT(next);
-      }
-      _data[index] = std::move(_data[next]);
-      if (RIGHT(next) >= _capacity || !_data[RIGHT(next)].has_value()) {
-        _data[next].reset();
-      } else {
-        shift(RIGHT(next), next - RIGHT(next));
-      }
-    }
-
-    while (index > 0) {
-      index = PARENT(index);
-      if (std::abs(_height[RIGHT(index)] - _height[LEFT(index)]) >= 2) {
-        rebalance(index);
-      }
-      _height[index] =
-          std::max(_height[LEFT(index)], _height[RIGHT(index)]) + 1;
-    }
-
-    _size--;
-    return true;
+  // Removes the item an iterator points to. Throws a std::logic_error if the
+  // iterator is past-the-last or belongs to another list. Invalidates every
+  // iterator into the list.
+  void erase(const iterator &position) {
+    if (position._list != this || position._current >= _capacity ||
+        !_data[position._current].has_value())
+      throw std::logic_error("Tried to erase through an invalid iterator");
+    IMDAST_BTAL_RECORD(
+        record(trace_op::REMOVE, &*_data[position._current], 0));
+    remove_at(position._current);
   }
 
   // Checks if the list contains an item.
   bool contains(const T &value) const noexcept {
+    IMDAST_BTAL_RECORD(record(trace_op::CONTAINS, &value, 0));
     size_t index = 0;
     while (index < _capacity && _data[index].has_value()) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
       if (value == _data[index].value())
         return true;
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
       index = value < _data[index].value() ? LEFT(index) : RIGHT(index);
     }
     return false;
@@ -489,7 +1350,10 @@ public:
   // contains that value. Otherwise, returns an iterator to the past-the-last
   // item.
   iterator find(const T &value) const noexcept {
-    return iterator::find(this, value);
+    IMDAST_BTAL_RECORD(record(trace_op::FIND, &value, 0));
+    iterator iter = iterator::find(this, value);
+    IMDAST_BTAL_RECORD(trace_steps(iter));
+    return iter;
   }
 
   // Returns an optional by-value to the nth (0-indexed) item in the list.
@@ -510,6 +1374,7 @@ public:
   T operator[](size_t index) const {
     if (index >= _size)
       throw std::logic_error("Subscript out-of-bounds");
+    IMDAST_BTAL_RECORD(record(trace_op::AT, nullptr, index));
     iterator iter = iterator(this);
     for (size_t i = 0; i < index; i++) {
       iter.next();
@@ -518,21 +1383,425 @@ public:
   }
 
   // Creates an iterator pointing to the smallest item in the list.
-  iterator begin() const noexcept { return iterator(this); }
+  iterator begin() const noexcept {
+    IMDAST_BTAL_RECORD(record(trace_op::ITERATE, nullptr, 0));
+    iterator iter(this);
+    IMDAST_BTAL_RECORD(trace_steps(iter));
+    return iter;
+  }
 
   // Creates an iterator pointing to the nth (0-indexed) smallest item in the
   // list. If index is >= list->size(), then the iterator will point to the
   // greatest item in the list.
   iterator begin_at(size_t index) const noexcept {
-    return iterator(this, index);
+    IMDAST_BTAL_RECORD(record(trace_op::ITERATE, nullptr, index));
+    iterator iter(this, index);
+    IMDAST_BTAL_RECORD(trace_steps(iter));
+    return iter;
   }
 
   // Creates an iterator pointing to the past-the-last item.
   iterator end() const noexcept { return iterator(this, _size); }
 
-  // Deep-copies the right list into the left.
-  binary_tree_array_list<T> &operator=(const binary_tree_array_list<T> &right) {
-    deep_copy(right);
+  // Creates a list from items that are already in order, laid out as a
+  // perfectly balanced tree, throwing a std::logic_error if they are not in
+  // order. Runs in O(n). With threads above 1 (or 0 for one per core),
+  // disjoint subtrees are built on up to that many threads.
+  static binary_tree_array_list from_sorted(std::vector<T> items,
+                                               unsigned threads = 1) {
+    if (!std::is_sorted(items.begin(), items.end()))
+      throw std::logic_error("Items are not in order");
+    binary_tree_array_list list;
+    list.assign_sorted(std::move(items), resolve_threads(threads));
+    return list;
+  }
+
+  // Rebuilds the list as a perfectly balanced tree, which minimizes its height
+  // and packs its items into the fewest levels. Keeps the allocation. Runs in
+  // O(capacity + n). With threads above 1 (or 0 for one per core), the rebuild
+  // is split across up to that many threads.
+  void optimize(unsigned threads = 1) {
+    std::vector<T> items;
+    items.reserve(_size);
+    if (_size) {
+      bool owned = !shared();
+      for (size_t index = leftmost(0);
+           index != std::numeric_limits<size_t>::max();
+           index = next_index(index)) {
+        T &item = _data[index].value();
+        items.push_back(owned ? std::move(item) : item);
+      }
+    }
+    assign_sorted(std::move(items), resolve_threads(threads));
+  }
+
+  // Calls f on every item, in no particular order. By default every call is
+  // made on this thread. With threads above 1 (or 0 for one per core), the
+  // slots are split across up to that many threads and f may be called
+  // concurrently. If f throws, one of the exceptions is rethrown once every
+  // thread is done.
+  template <class F> void for_each(F f, unsigned threads = 1) const {
+    parallel_ranges(0, _capacity, resolve_threads(threads),
+                    [this, &f](size_t begin, size_t end) {
+                      for (size_t i = begin; i < end; i++) {
+                        if (_data[i].has_value())
+                          f(*_data[i]);
+                      }
+                    });
+  }
+
+  // Combines every item with op, in no particular order. With threads above 1
+  // (or 0 for one per core), the slots are split across up to that many
+  // threads and op may be called concurrently. As with std::reduce, op must
+  // be associative and commutative. Every thread starts from identity, so it
+  // must leave other values unchanged (e.g. 0 for addition).
+  template <class U, class Op>
+  U reduce(U identity, Op op, unsigned threads = 1) const {
+    return reduce_range(0, _capacity, resolve_threads(threads), identity, op);
+  }
+
+  // Writes every item in order to out, returning the iterator past the last
+  // one written. Slots are visited by index arithmetic alone, without
+  // comparing or wrapping items as the iterator does. If out is a
+  // random-access iterator and threads is above 1 (or 0 for one per core),
+  // subtrees are copied on up to that many threads, each into its own part of
+  // the output.
+  template <class OutputIt>
+  OutputIt copy_to(OutputIt out, unsigned threads = 1) const {
+    if constexpr (std::random_access_iterator<OutputIt>) {
+      threads = resolve_threads(threads);
+      if (threads > 1 && _size >= 2 * parallel_grain) {
+        copy_to_parallel(out, threads);
+        return out + _size;
+      }
+    }
+    if (_size == 0)
+      return out;
+    for (size_t index = leftmost(0);
+         index != std::numeric_limits<size_t>::max();
+         index = next_index(index)) {
+      *out++ = *_data[index];
+    }
+    return out;
+  }
+
+  // Returns every item in order. See copy_to().
+  std::vector<T> to_vector(unsigned threads = 1) const {
+    std::vector<T> result;
+    if constexpr (std::is_default_constructible_v<T>) {
+      result.resize(_size);
+      copy_to(result.begin(), threads);
+    } else {
+      result.reserve(_size);
+      copy_to(std::back_inserter(result));
+    }
+    return result;
+  }
+
+  // Returns the summary of every item in the list, or the augmentation's
+  // identity if it is empty. Runs in O(1).
+  aggregate_type aggregate() const
+    requires augmented
+  {
+    return aggregate_at(0);
+  }
+
+  // Returns the summary of the items not less than lo and less than hi,
+  // combined in order, or the augmentation's identity if there are none. Runs
+  // in O(log n) regardless of how many items are in the range.
+  aggregate_type aggregate(const T &lo, const T &hi) const
+    requires augmented
+  {
+    return aggregate_range(0, &lo, &hi);
+  }
+
+  // Returns by-value the smallest item, or nullopt if the list is empty. Runs
+  // in O(1).
+  std::optional<T> min() const noexcept {
+    if (_size == 0)
+      return std::nullopt;
+    return _data[_min_index];
+  }
+
+  // Returns by-value the greatest item, or nullopt if the list is empty. Runs
+  // in O(1).
+  std::optional<T> max() const noexcept {
+    if (_size == 0)
+      return std::nullopt;
+    return _data[_max_index];
+  }
+
+  // Removes and returns the smallest item, or nullopt if the list is empty.
+  // The smallest item has no left child and at most a single leaf on its
+  // right, so no subtree has to be shifted to fill its slot.
+  std::optional<T> pop_min() {
+    if (_size == 0)
+      return std::nullopt;
+    return pop_at(_min_index);
+  }
+
+  // Removes and returns the greatest item, or nullopt if the list is empty.
+  std::optional<T> pop_max() {
+    if (_size == 0)
+      return std::nullopt;
+    return pop_at(_max_index);
+  }
+
+  // Removes the k smallest items (or every item, if there are fewer) and
+  // returns them in order. When k is small they are popped one at a time,
+  // each finding the next smallest item in O(1) unless a rotation moves it;
+  // otherwise the remaining items are rebuilt into a perfectly balanced tree
+  // in one pass, keeping the allocation.
+  std::vector<T> extract_top_k(size_t k) {
+    k = std::min(k, _size);
+    std::vector<T> result;
+    if (k == 0)
+      return result;
+    result.reserve(k);
+    if (few_enough(k, _size)) {
+      while (result.size() < k) {
+        result.push_back(std::move(*pop_min()));
+      }
+      return result;
+    }
+
+    bool owned = !shared();
+    std::vector<T> rest;
+    rest.reserve(_size - k);
+    for (size_t index = _min_index;
+         index != std::numeric_limits<size_t>::max();
+         index = next_index(index)) {
+      T &item = _data[index].value();
+      if (result.size() < k)
+        IMDAST_BTAL_RECORD(record(trace_op::REMOVE, &item, 0));
+      (result.size() < k ? result : rest)
+          .push_back(owned ? std::move(item) : item);
+    }
+    assign_sorted(std::move(rest));
+    return result;
+  }
+
+  // Returns a list of the items in either this list or other. Runs in
+  // O(n + m) and builds the result as a perfectly balanced tree. An item that
+  // appears several times is kept as often as it appears in either list.
+  binary_tree_array_list
+  merge_union(const binary_tree_array_list &other) const {
+    binary_tree_array_list result;
+    result.assign_sorted(combine(other, set_operation::UNION));
+    return result;
+  }
+
+  // Returns a list of the items in both this list and other. Runs in
+  // O(n + m) and builds the result as a perfectly balanced tree.
+  binary_tree_array_list
+  intersect(const binary_tree_array_list &other) const {
+    binary_tree_array_list result;
+    result.assign_sorted(combine(other, set_operation::INTERSECTION));
+    return result;
+  }
+
+  // Returns a list of the items in this list but not in other. Runs in
+  // O(n + m) and builds the result as a perfectly balanced tree.
+  binary_tree_array_list
+  difference(const binary_tree_array_list &other) const {
+    binary_tree_array_list result;
+    result.assign_sorted(combine(other, set_operation::DIFFERENCE));
+    return result;
+  }
+
+  // Like merge_union(), but replaces this list's contents, reusing its
+  // allocation when the result fits.
+  void merge_union_in_place(const binary_tree_array_list &other) {
+    assign_sorted(combine(other, set_operation::UNION));
+  }
+
+  // Like intersect(), but replaces this list's contents, reusing its
+  // allocation.
+  void intersect_in_place(const binary_tree_array_list &other) {
+    assign_sorted(combine(other, set_operation::INTERSECTION));
+  }
+
+  // Like difference(), but replaces this list's contents, reusing its
+  // allocation.
+  void difference_in_place(const binary_tree_array_list &other) {
+    assign_sorted(combine(other, set_operation::DIFFERENCE));
+  }
+
+  // Splits the list at key. Returns a list of the items less than key and a
+  // list of the remaining items, both laid out as perfectly balanced trees.
+  // Runs in O(n).
+  std::pair<binary_tree_array_list, binary_tree_array_list>
+  split(const T &key) const {
+    std::vector<T> left;
+    std::vector<T> right;
+    right.reserve(_size);
+    constexpr size_t end = std::numeric_limits<size_t>::max();
+    size_t index = _size ? leftmost(0) : end;
+    for (; index != end; index = next_index(index)) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (!(_data[index].value() < key))
+        break;
+      left.push_back(_data[index].value());
+    }
+    for (; index != end; index = next_index(index)) {
+      right.push_back(_data[index].value());
+    }
+    std::pair<binary_tree_array_list, binary_tree_array_list> result;
+    result.first.assign_sorted(std::move(left));
+    result.second.assign_sorted(std::move(right));
+    return result;
+  }
+
+  // Removes every item not less than key from this list and returns them as a
+  // new list. When one side of the split is small, only that side's items are
+  // moved, one at a time; otherwise both sides are rebuilt in O(n), and this
+  // list keeps its allocation.
+  binary_tree_array_list split_off(const T &key) {
+    constexpr size_t end = std::numeric_limits<size_t>::max();
+    // Walk in from both ends at once, so that finding the smaller side costs
+    // time proportional to that side only.
+    size_t low = _size ? leftmost(0) : end;
+    size_t high = _size ? rightmost(0) : end;
+    size_t count = 0;
+    bool left_is_small;
+    while (true) {
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (low == end || !(_data[low].value() < key)) {
+        left_is_small = true;
+        break;
+      }
+      IMDAST_BTAL_COUNT(_counters.comparisons++);
+      if (high == end || _data[high].value() < key) {
+        left_is_small = false;
+        break;
+      }
+      if (!few_enough(++count, _size)) {
+        // Neither side is small: move everything out and rebuild both. Items
+        // in storage shared with other lists are copied instead.
+        bool owned = !shared();
+        std::vector<T> left;
+        std::vector<T> right;
+        size_t index = leftmost(0);
+        for (; index != end && _data[index].value() < key;
+             index = next_index(index)) {
+          T &item = _data[index].value();
+          left.push_back(owned ? std::move(item) : item);
+        }
+        for (; index != end; index = next_index(index)) {
+          T &item = _data[index].value();
+          right.push_back(owned ? std::move(item) : item);
+        }
+        binary_tree_array_list result;
+        result.assign_sorted(std::move(right));
+        assign_sorted(std::move(left));
+        return result;
+      }
+      low = next_index(low);
+      high = prev_index(high);
+    }
+
+    std::vector<T> small;
+    small.reserve(count);
+    if (left_is_small) {
+      for (size_t index = leftmost(0); small.size() < count;
+           index = next_index(index)) {
+        small.push_back(_data[index].value());
+      }
+    } else {
+      for (size_t index = rightmost(0); small.size() < count;
+           index = prev_index(index)) {
+        small.push_back(_data[index].value());
+      }
+      std::reverse(small.begin(), small.end());
+    }
+    for (const T &item : small) {
+      remove(item);
+    }
+
+    binary_tree_array_list result;
+    if (left_is_small) {
+      result = std::move(*this);
+      assign_sorted(std::move(small));
+    } else {
+      result.assign_sorted(std::move(small));
+    }
+    return result;
+  }
+
+  // Concatenates two lists where no item of left is greater than any item of
+  // right, throwing a std::logic_error otherwise. If one list is much smaller
+  // than the other, its items are inserted into the larger list one at a time,
+  // reusing the larger list's layout; otherwise both are rebuilt together into
+  // one perfectly balanced tree in O(n + m).
+  static binary_tree_array_list join(binary_tree_array_list left,
+                                        binary_tree_array_list right) {
+    if (left.empty())
+      return right;
+    if (right.empty())
+      return left;
+    if (right._data[right.leftmost(0)].value() <
+        left._data[left.rightmost(0)].value())
+      throw std::logic_error("Joined lists overlap");
+
+    binary_tree_array_list &large = left._size >= right._size ? left : right;
+    binary_tree_array_list &small = left._size >= right._size ? right : left;
+    constexpr size_t end = std::numeric_limits<size_t>::max();
+    if (few_enough(small._size, large._size)) {
+      for (size_t index = small.leftmost(0); index != end;
+           index = small.next_index(index)) {
+        large.insert(small._data[index].value());
+      }
+      return std::move(large);
+    }
+
+    std::vector<T> items;
+    items.reserve(left._size + right._size);
+    for (binary_tree_array_list *list : {&left, &right}) {
+      bool owned = !list->shared();
+      for (size_t index = list->leftmost(0); index != end;
+           index = list->next_index(index)) {
+        T &item = list->_data[index].value();
+        items.push_back(owned ? std::move(item) : item);
+      }
+    }
+    large.assign_sorted(std::move(items));
+    return std::move(large);
+  }
+
+  // Copies the right list into the left in O(1), sharing storage until either
+  // is modified.
+  binary_tree_array_list &
+  operator=(const binary_tree_array_list &right) noexcept {
+    if (this != &right) {
+      if (right._refs)
+        right._refs->fetch_add(1, std::memory_order_relaxed);
+      release();
+      _data = right._data;
+      _height = right._height;
+      _aggregate = right._aggregate;
+      _refs = right._refs;
+      _size = right._size;
+      _capacity = right._capacity;
+      _min_index = right._min_index;
+      _max_index = right._max_index;
+    }
+    return *this;
+  }
+
+  // Moves the right list's allocation into the left, leaving the right empty.
+  binary_tree_array_list &
+  operator=(binary_tree_array_list &&right) noexcept {
+    if (this != &right) {
+      release();
+      _data = std::exchange(right._data, nullptr);
+      _height = std::exchange(right._height, nullptr);
+      _aggregate = std::exchange(right._aggregate, nullptr);
+      _refs = std::exchange(right._refs, nullptr);
+      _size = std::exchange(right._size, 0);
+      _capacity = std::exchange(right._capacity, 0);
+      _min_index = right._min_index;
+      _max_index = right._max_index;
+    }
     return *this;
   }
 }; // class binary_tree_array_list
@@ -0,0 +1,385 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_BOUNDED_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_BOUNDED_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace imdast {
+// A list of trivially copyable items whose operations each do a bounded
+// amount of work, for callers that care about tail latency more than
+// throughput. Items live in a perfectly balanced tree that is never modified
+// once built. Writes go to a small buffer, as in
+// staged_binary_tree_array_list, and a full buffer is merged into a new tree
+// built in a fresh allocation a few items per write while reads keep using the
+// old one. Nothing is ever realloc()ed or shift()ed, so no call pays for
+// growing the whole tree or for a rotation near the root.
+//
+// The buffer is kept sorted, so freezing it costs nothing. With b the buffer
+// capacity, which is kept at about 4 sqrt(n), a write moves O(b) buffered
+// items and O(n / b) items of the merge. Lookups take O(log n).
+template <class T> class bounded_binary_tree_array_list {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Bounded items must be trivially copyable");
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  struct free_deleter {
+    void operator()(T *data) const noexcept { free(data); }
+  };
+
+  // A perfectly balanced tree of size sorted items. The item of rank k sits
+  // in the slot reached by halving [0, size) until k is the midpoint, so
+  // which slots are in use follows from size alone and none are marked.
+  struct layout {
+    std::unique_ptr<T[], free_deleter> data;
+    size_t size = 0;
+  };
+
+  // Visits the slots of a layout in rank order, keeping the path from the
+  // root to the current slot so that each step is amortized O(1).
+  class cursor {
+    struct frame {
+      size_t slot;
+      size_t low;
+      size_t high;
+    };
+    frame _path[std::numeric_limits<size_t>::digits];
+    size_t _depth = 0;
+
+    void descend(size_t slot, size_t low, size_t high) noexcept {
+      while (low < high) {
+        _path[_depth++] = {slot, low, high};
+        high = low + (high - low) / 2;
+        slot = LEFT(slot);
+      }
+    }
+
+  public:
+    // Starts at the slot of rank 0 in a layout of size items.
+    void reset(size_t size) noexcept {
+      _depth = 0;
+      descend(0, 0, size);
+    }
+
+    // Returns whether every slot has been visited.
+    bool done() const noexcept { return _depth == 0; }
+
+    // Returns the current slot.
+    size_t slot() const noexcept { return _path[_depth - 1].slot; }
+
+    // Moves to the slot of the next rank.
+    void next() noexcept {
+      frame top = _path[--_depth];
+      descend(RIGHT(top.slot), top.low + (top.high - top.low) / 2 + 1,
+              top.high);
+    }
+  }; // class cursor
+
+  layout _tree;
+  // Items inserted and removed since the buffer was last frozen, sorted.
+  // Removes are of items held by the tree once merging finishes.
+  std::vector<T> _inserts;
+  std::vector<T> _removes;
+  // The frozen buffer being merged into _next, sorted.
+  std::vector<T> _merging_inserts;
+  std::vector<T> _merging_removes;
+  layout _next;
+  bool _merging = false;
+  // Merge progress: the next slot of _tree to read, the next slot of _next
+  // to fill, and the next items of the frozen buffer.
+  cursor _reading;
+  cursor _writing;
+  size_t _insert_rank = 0;
+  size_t _remove_rank = 0;
+  // Number of items the merge takes per write.
+  size_t _step = 0;
+  size_t _min_buffer_capacity;
+  size_t _buffer_capacity;
+
+  // Allocates a layout for size items, leaving its slots uninitialized so
+  // that no page is touched before the merge writes to it. Throws
+  // std::bad_alloc on failure.
+  static layout allocate(size_t size) {
+    layout result;
+    result.size = size;
+    if (size == 0)
+      return result;
+    size_t capacity = (size_t(1) << std::bit_width(size)) - 1;
+    result.data.reset(static_cast<T *>(malloc(capacity * sizeof(T))));
+    if (!result.data)
+      throw std::bad_alloc();
+    return result;
+  }
+
+  // Returns the slot holding the item of rank rank in a layout of size items.
+  static size_t slot_of(size_t rank, size_t size) noexcept {
+    size_t low = 0;
+    size_t high = size;
+    size_t slot = 0;
+    while (true) {
+      size_t middle = low + (high - low) / 2;
+      if (rank == middle)
+        return slot;
+      if (rank < middle) {
+        high = middle;
+        slot = LEFT(slot);
+      } else {
+        low = middle + 1;
+        slot = RIGHT(slot);
+      }
+    }
+  }
+
+  // Number of items in a sorted buffer equal to value.
+  static size_t count_sorted(const std::vector<T> &buffer, const T &value) {
+    auto range = std::equal_range(buffer.begin(), buffer.end(), value);
+    return range.second - range.first;
+  }
+
+  // Returns whether the tree holds more than skip items equal to value.
+  bool tree_holds(const T &value, size_t skip) const noexcept {
+    size_t low = 0;
+    size_t high = _tree.size;
+    size_t slot = 0;
+    while (low < high) {
+      size_t middle = low + (high - low) / 2;
+      if (_tree.data[slot] < value) {
+        low = middle + 1;
+        slot = RIGHT(slot);
+      } else {
+        high = middle;
+        slot = LEFT(slot);
+      }
+    }
+    // low is now the rank of the first item not less than value.
+    size_t rank = low + skip;
+    return rank < _tree.size && _tree.data[slot_of(rank, _tree.size)] == value;
+  }
+
+  // Returns whether the tree, with the buffer being merged applied, holds more
+  // than skip items equal to value.
+  bool holds(const T &value, size_t skip) const noexcept {
+    size_t inserted = count_sorted(_merging_inserts, value);
+    size_t removed = count_sorted(_merging_removes, value);
+    if (inserted > skip + removed)
+      return true;
+    return tree_holds(value, skip + removed - inserted);
+  }
+
+  // Returns items minus removes, merged with inserts. All three must be in
+  // order.
+  static std::vector<T> applied(std::vector<T> items,
+                                const std::vector<T> &inserts,
+                                const std::vector<T> &removes) {
+    if (!removes.empty()) {
+      size_t kept = 0;
+      auto removed = removes.begin();
+      for (size_t i = 0; i < items.size(); i++) {
+        if (removed != removes.end() && *removed == items[i])
+          ++removed;
+        else
+          items[kept++] = items[i];
+      }
+      items.erase(items.begin() + kept, items.end());
+    }
+    std::vector<T> result;
+    result.reserve(items.size() + inserts.size());
+    std::merge(items.begin(), items.end(), inserts.begin(), inserts.end(),
+               std::back_inserter(result));
+    return result;
+  }
+
+  // Makes the merged tree the one reads use and drops the merged buffer.
+  void finish_merge() noexcept {
+    _tree = std::move(_next);
+    _next = layout();
+    _merging_inserts.clear();
+    _merging_removes.clear();
+    _merging = false;
+  }
+
+  // Takes up to budget items from the tree and the buffer being merged,
+  // placing each one that is not removed in the new tree.
+  void advance(size_t budget) {
+    for (; _merging && budget > 0; budget--) {
+      bool from_tree = !_reading.done() &&
+                       (_insert_rank == _merging_inserts.size() ||
+                        !(_merging_inserts[_insert_rank] <
+                          _tree.data[_reading.slot()]));
+      const T &item = from_tree ? _tree.data[_reading.slot()]
+                                : _merging_inserts[_insert_rank];
+      if (_remove_rank < _merging_removes.size() &&
+          _merging_removes[_remove_rank] == item) {
+        _remove_rank++;
+      } else {
+        _next.data[_writing.slot()] = item;
+        _writing.next();
+      }
+      if (from_tree)
+        _reading.next();
+      else
+        _insert_rank++;
+      if (_reading.done() && _insert_rank == _merging_inserts.size())
+        finish_merge();
+    }
+  }
+
+  // Freezes the buffer and starts merging it into a new tree, at a pace that
+  // ends the merge before the write that fills the next buffer. Finishes the
+  // previous merge first if it is somehow still running.
+  void start_merge() {
+    advance(npos);
+    size_t size = _tree.size + _inserts.size() - _removes.size();
+    _next = allocate(size);
+    _merging_inserts.swap(_inserts);
+    _merging_removes.swap(_removes);
+    _merging = true;
+    _reading.reset(_tree.size);
+    _writing.reset(size);
+    _insert_rank = _remove_rank = 0;
+    // About 4 sqrt(n), which balances scanning the buffer against the share
+    // of the merge each write does.
+    _buffer_capacity = std::max(_min_buffer_capacity,
+                                size_t(1) << (std::bit_width(size) / 2 + 2));
+    _inserts.reserve(_buffer_capacity);
+    _removes.reserve(_buffer_capacity);
+    _step = (_tree.size + _merging_inserts.size()) / (_buffer_capacity - 1) + 1;
+    if (_tree.size == 0 && _merging_inserts.empty())
+      finish_merge();
+  }
+
+  // Advances the merge by a step, and starts a new one if the buffer is full.
+  void after_write() {
+    advance(_step);
+    if (_inserts.size() + _removes.size() >= _buffer_capacity)
+      start_merge();
+  }
+
+public:
+  // Creates an empty list whose buffer holds at least min_buffer_capacity
+  // pending inserts and removes. Throws a std::logic_error if
+  // min_buffer_capacity is less than 2, which leaves no writes to spread a
+  // merge over.
+  explicit bounded_binary_tree_array_list(size_t min_buffer_capacity = 64)
+      : _min_buffer_capacity(min_buffer_capacity),
+        _buffer_capacity(min_buffer_capacity) {
+    if (min_buffer_capacity < 2)
+      throw std::logic_error("Buffer capacity must be at least 2");
+  }
+
+  // Returns the number of items in the list.
+  size_t size() const noexcept {
+    return _tree.size + _merging_inserts.size() - _merging_removes.size() +
+           _inserts.size() - _removes.size();
+  }
+
+  // Returns if the list is empty.
+  bool empty() const noexcept { return !size(); }
+
+  // Returns the number of pending inserts and removes in the buffer.
+  size_t buffered() const noexcept {
+    return _inserts.size() + _removes.size();
+  }
+
+  // Returns the number of pending inserts and removes that start a merge.
+  size_t buffer_capacity() const noexcept { return _buffer_capacity; }
+
+  // Returns whether a merge is in progress.
+  bool merging() const noexcept { return _merging; }
+
+  // Removes all items from the list.
+  void clear() noexcept {
+    _tree = layout();
+    _next = layout();
+    _inserts.clear();
+    _removes.clear();
+    _merging_inserts.clear();
+    _merging_removes.clear();
+    _merging = false;
+    _buffer_capacity = _min_buffer_capacity;
+  }
+
+  // Inserts a value into the buffer and advances the merge.
+  void insert(const T &value) {
+    _inserts.insert(std::upper_bound(_inserts.begin(), _inserts.end(), value),
+                    value);
+    after_write();
+  }
+
+  // Removes an item from the list, returning whether said item was in the
+  // list. A pending insert of the item is cancelled; otherwise the remove is
+  // recorded in the buffer.
+  bool remove(const T &value) {
+    auto pending = std::lower_bound(_inserts.begin(), _inserts.end(), value);
+    auto removed = std::equal_range(_removes.begin(), _removes.end(), value);
+    if (pending != _inserts.end() && *pending == value) {
+      _inserts.erase(pending);
+    } else if (holds(value, removed.second - removed.first)) {
+      _removes.insert(removed.second, value);
+    } else {
+      return false;
+    }
+    after_write();
+    return true;
+  }
+
+  // Checks if the list contains an item.
+  bool contains(const T &value) const noexcept {
+    return std::binary_search(_inserts.begin(), _inserts.end(), value) ||
+           holds(value, count_sorted(_removes, value));
+  }
+
+  // Finishes any merge and merges the buffer, doing O(n) work at once.
+  void flush() {
+    if (!_inserts.empty() || !_removes.empty())
+      start_merge();
+    advance(npos);
+  }
+
+  // Returns every item in the list, in order, without merging anything.
+  std::vector<T> to_vector() const {
+    std::vector<T> items;
+    items.reserve(_tree.size);
+    cursor reading;
+    for (reading.reset(_tree.size); !reading.done(); reading.next()) {
+      items.push_back(_tree.data[reading.slot()]);
+    }
+    items = applied(std::move(items), _merging_inserts, _merging_removes);
+    return applied(std::move(items), _inserts, _removes);
+  }
+}; // class bounded_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_BOUNDED_BINARY_TREE_ARRAY_LIST_H
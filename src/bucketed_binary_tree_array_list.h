@@ -0,0 +1,312 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_BUCKETED_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_BUCKETED_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+namespace imdast {
+// A binary_tree_array_list whose slots each hold a small sorted bucket of up to
+// BucketSize items instead of a single item. Buckets are ordered in the tree by
+// their smallest item, so the tree is about log2(BucketSize) levels shorter and
+// most inserts and removes are a short move inside one bucket. The tree itself
+// is only restructured when a bucket splits or merges.
+template <class T, size_t BucketSize = 32>
+class bucketed_binary_tree_array_list {
+  static_assert(BucketSize >= 4, "Buckets must hold at least 4 items");
+
+  // A sorted run of items. Buckets compare by their smallest item, then by
+  // their greatest: when a bucket full of one duplicated item splits, both
+  // halves start with the same item, and only the second can hold anything
+  // greater.
+  struct bucket {
+    T items[BucketSize];
+    size_t count;
+
+    bool operator<(const bucket &other) const {
+      if (items[0] < other.items[0])
+        return true;
+      if (other.items[0] < items[0])
+        return false;
+      return items[count - 1] < other.items[other.count - 1];
+    }
+
+    // Number of items less than value. Branch-free so that the loop can be
+    // vectorized.
+    size_t lower(const T &value) const {
+      size_t result = 0;
+      for (size_t i = 0; i < count; i++) {
+        result += items[i] < value;
+      }
+      return result;
+    }
+
+    // Number of items not greater than value.
+    size_t upper(const T &value) const {
+      size_t result = 0;
+      for (size_t i = 0; i < count; i++) {
+        result += !(value < items[i]);
+      }
+      return result;
+    }
+  };
+
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  binary_tree_array_list<bucket> _tree;
+  size_t _size;
+
+  // Returns a bucket that is about to be modified in place, first giving the
+  // tree its own storage if a copy of this list shares it.
+  bucket &bucket_at(size_t index) {
+    _tree.detach();
+    return _tree._data[index].value();
+  }
+
+  const bucket &bucket_at(size_t index) const {
+    return _tree._data[index].value();
+  }
+
+  // Returns the index of the bucket that value belongs in: the last bucket
+  // whose smallest item is not greater than value, or the first bucket if
+  // value is smaller than every item. Returns npos if the list is empty.
+  size_t find_bucket(const T &value) const noexcept {
+    size_t index = 0;
+    size_t candidate = npos;
+    while (index < _tree._capacity && _tree._data[index].has_value()) {
+      if (value < bucket_at(index).items[0]) {
+        index = LEFT(index);
+      } else {
+        candidate = index;
+        index = RIGHT(index);
+      }
+    }
+    if (candidate == npos && !_tree.empty())
+      return _tree.leftmost(0);
+    return candidate;
+  }
+
+public:
+  class iterator {
+    const bucketed_binary_tree_array_list<T, BucketSize> *_list;
+    size_t _bucket;
+    size_t _position;
+
+  public:
+    // Creates an iterator with no associated list.
+    iterator() noexcept : _list(nullptr), _bucket(npos), _position(0) {}
+
+    // Creates an iterator pointing to the position-th item of the bucket at
+    // index bucket. Use begin() and end() instead.
+    iterator(const bucketed_binary_tree_array_list<T, BucketSize> *list,
+             size_t bucket, size_t position) noexcept
+        : _list(list), _bucket(bucket), _position(position) {}
+
+    // Returns an optional by-value to the current item. May be nullopt.
+    std::optional<T> get() const noexcept {
+      if (!_list || _bucket == npos)
+        return std::nullopt;
+      return _list->bucket_at(_bucket).items[_position];
+    }
+
+    // Moves the iterator to the next item in the list. Returns whether the
+    // iterator actually moved.
+    bool next() noexcept {
+      if (!_list || _bucket == npos)
+        return false;
+      if (++_position == _list->bucket_at(_bucket).count) {
+        _bucket = _list->_tree.next_index(_bucket);
+        _position = 0;
+      }
+      return true;
+    }
+
+    // Returns the value by-value at the iterator's current position. Throws a
+    // std::logic_error if called on the past-the-last item.
+    T operator*() const {
+      std::optional<T> item = get();
+      return item.has_value() ? item.value()
+                              : throw std::logic_error(
+                                    "Tried to dereference past-the-last item");
+    }
+
+    // Moves the iterator to the next item in the list. Returns a reference to
+    // this iterator.
+    iterator &operator++() noexcept {
+      next();
+      return *this;
+    }
+
+    // Tests if two iterators are identical.
+    bool operator==(const iterator &iter) const noexcept {
+      return _list == iter._list && _bucket == iter._bucket &&
+             _position == iter._position;
+    }
+
+    // Tests if two iterators are not identical.
+    bool operator!=(const iterator &iter) const noexcept {
+      return !(*this == iter);
+    }
+  }; // class iterator
+
+  // Creates an empty list.
+  bucketed_binary_tree_array_list() noexcept : _size(0) {}
+
+  // Returns the number of items in the list.
+  size_t size() const noexcept { return _size; }
+
+  // Returns if the list is empty.
+  bool empty() const noexcept { return !_size; }
+
+  // Returns the number of buckets, i.e. the number of slots used in the
+  // underlying tree.
+  size_t bucket_count() const noexcept { return _tree.size(); }
+
+  // Reports the shape and memory use of the underlying tree of buckets. See
+  // binary_tree_array_list::stats().
+  typename binary_tree_array_list<bucket>::statistics stats() const {
+    return _tree.stats();
+  }
+
+  // Removes all items from the list. Does not shrink the list's allocation.
+  void clear() {
+    _tree.clear();
+    _size = 0;
+  }
+
+  // Inserts a value into the list in-order. If the tree has to grow and that
+  // throws, the list is left unchanged.
+  void insert(const T &value) {
+    size_t index = find_bucket(value);
+    if (index == npos) {
+      bucket first;
+      first.items[0] = value;
+      first.count = 1;
+      _tree.insert(first);
+      _size++;
+      return;
+    }
+
+    bucket &target = bucket_at(index);
+    size_t position = target.upper(value);
+    if (target.count < BucketSize) {
+      std::move_backward(target.items + position, target.items + target.count,
+                         target.items + target.count + 1);
+      target.items[position] = value;
+      target.count++;
+      _size++;
+      return;
+    }
+
+    // The bucket is full: move its upper half into a new bucket, then add the
+    // new bucket to the tree.
+    constexpr size_t half = BucketSize / 2;
+    bucket upper;
+    std::move(target.items + half, target.items + BucketSize, upper.items);
+    upper.count = BucketSize - half;
+    target.count = half;
+    bool goes_up = position > half;
+    bucket &destination = goes_up ? upper : target;
+    if (goes_up)
+      position -= half;
+    std::move_backward(destination.items + position,
+                       destination.items + destination.count,
+                       destination.items + destination.count + 1);
+    destination.items[position] = value;
+    destination.count++;
+    try {
+      _tree.insert(upper);
+    } catch (...) {
+      // Undo the split. Growing the tree keeps every bucket at its index, and
+      // a failed insert rotates nothing, so the bucket is still at index.
+      bucket &original = bucket_at(index);
+      bucket &holder = goes_up ? upper : original;
+      std::move(holder.items + position + 1, holder.items + holder.count,
+                holder.items + position);
+      holder.count--;
+      std::move(upper.items, upper.items + upper.count, original.items + half);
+      original.count = BucketSize;
+      throw;
+    }
+    _size++;
+  }
+
+  // Removes an item from the list, returning whether said item was in the
+  // list.
+  bool remove(const T &value) {
+    size_t index = find_bucket(value);
+    if (index == npos)
+      return false;
+    bucket &target = bucket_at(index);
+    size_t position = target.lower(value);
+    if (position == target.count || !(target.items[position] == value))
+      return false;
+
+    std::move(target.items + position + 1, target.items + target.count,
+              target.items + position);
+    target.count--;
+    _size--;
+
+    if (target.count == 0) {
+      _tree.remove_at(index);
+    } else if (target.count < BucketSize / 4) {
+      // Merge a nearly empty bucket with its successor when the result leaves
+      // room for further inserts.
+      size_t next = _tree.next_index(index);
+      if (next != npos &&
+          target.count + bucket_at(next).count <= BucketSize * 3 / 4) {
+        bucket &source = bucket_at(next);
+        std::move(source.items, source.items + source.count,
+                  target.items + target.count);
+        target.count += source.count;
+        _tree.remove_at(next);
+      }
+    }
+    return true;
+  }
+
+  // Checks if the list contains an item.
+  bool contains(const T &value) const noexcept {
+    size_t index = find_bucket(value);
+    if (index == npos)
+      return false;
+    const bucket &target = bucket_at(index);
+    size_t position = target.lower(value);
+    return position < target.count && target.items[position] == value;
+  }
+
+  // Creates an iterator pointing to the smallest item in the list.
+  iterator begin() const noexcept {
+    return iterator(this, _tree.empty() ? npos : _tree.leftmost(0), 0);
+  }
+
+  // Creates an iterator pointing to the past-the-last item.
+  iterator end() const noexcept { return iterator(this, npos, 0); }
+}; // class bucketed_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_BUCKETED_BINARY_TREE_ARRAY_LIST_H
@@ -0,0 +1,251 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_COMBINING_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_COMBINING_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace imdast {
+// A binary_tree_array_list that many threads can write to at once through
+// flat combining. A thread publishes its operation in a free slot of a
+// publication array, then either waits for it to be applied or, if it can take
+// the combiner lock, applies every published operation itself as one batch
+// sorted by value. The list is only ever touched by the combiner, so it stays
+// in one core's cache, and a batch of inserts walks it in order.
+//
+// Operations in one batch were all in progress at once, so the combiner may
+// order them as it likes: lookups see the list as it was before the batch,
+// then removes are applied, then inserts.
+template <class T> class combining_binary_tree_array_list {
+  enum class operation : uint8_t { INSERT, REMOVE, CONTAINS };
+  enum class state : uint8_t { FREE, CLAIMED, PENDING, DONE };
+
+  // A slot of the publication array, on its own cache line so that threads
+  // publishing into neighbouring slots do not contend.
+  struct alignas(64) record {
+    std::atomic<state> status{state::FREE};
+    operation op;
+    std::optional<T> value;
+    bool result;
+    std::exception_ptr error;
+  };
+
+  binary_tree_array_list<T> _list;
+  std::unique_ptr<record[]> _records;
+  size_t _record_count;
+  std::mutex _combiner;
+  // Scratch space of the combiner, kept to avoid allocating per batch.
+  std::vector<record *> _batch;
+  std::vector<T> _inserts;
+  std::atomic<size_t> _size;
+  std::atomic<size_t> _batches;
+
+  // Claims a free slot, starting from one chosen by the calling thread's id
+  // so that threads tend to reuse their own slot.
+  record &claim() {
+    size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    while (true) {
+      for (size_t i = 0; i < _record_count; i++) {
+        record &slot = _records[(start + i) % _record_count];
+        state expected = state::FREE;
+        if (slot.status.load(std::memory_order_relaxed) == state::FREE &&
+            slot.status.compare_exchange_strong(expected, state::CLAIMED,
+                                                std::memory_order_acquire))
+          return slot;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // Applies the operations of the given records, which must be sorted by
+  // value, to the list.
+  void apply(const std::vector<record *> &batch) {
+    for (record *slot : batch) {
+      if (slot->op == operation::CONTAINS)
+        slot->result = _list.contains(*slot->value);
+    }
+    for (record *slot : batch) {
+      if (slot->op != operation::REMOVE)
+        continue;
+      try {
+        slot->result = _list.remove(*slot->value);
+      } catch (...) {
+        slot->error = std::current_exception();
+      }
+    }
+
+    _inserts.clear();
+    for (record *slot : batch) {
+      if (slot->op == operation::INSERT)
+        _inserts.push_back(*slot->value);
+    }
+    if (_inserts.empty())
+      return;
+    // A batch that is large next to the list is merged in with one rebuild,
+    // like optimize(), instead of inserted one item at a time.
+    if (_inserts.size() * 8 > _list.size()) {
+      try {
+        std::vector<T> items = _list.to_vector(1);
+        std::vector<T> merged;
+        merged.reserve(items.size() + _inserts.size());
+        std::merge(std::make_move_iterator(items.begin()),
+                   std::make_move_iterator(items.end()), _inserts.begin(),
+                   _inserts.end(), std::back_inserter(merged));
+        _list.assign_sorted(std::move(merged));
+        for (record *slot : batch) {
+          if (slot->op == operation::INSERT)
+            slot->result = true;
+        }
+      } catch (...) {
+        for (record *slot : batch) {
+          if (slot->op == operation::INSERT)
+            slot->error = std::current_exception();
+        }
+      }
+      return;
+    }
+    for (record *slot : batch) {
+      if (slot->op != operation::INSERT)
+        continue;
+      try {
+        _list.insert(*slot->value);
+        slot->result = true;
+      } catch (...) {
+        slot->error = std::current_exception();
+      }
+    }
+  }
+
+  // Collects every published operation and applies them as one batch. Must
+  // be called with the combiner lock held.
+  void combine() {
+    _batch.clear();
+    for (size_t i = 0; i < _record_count; i++) {
+      if (_records[i].status.load(std::memory_order_acquire) == state::PENDING)
+        _batch.push_back(&_records[i]);
+    }
+    if (_batch.empty())
+      return;
+    std::sort(_batch.begin(), _batch.end(), [](record *a, record *b) {
+      return *a->value < *b->value;
+    });
+    apply(_batch);
+    _size.store(_list.size(), std::memory_order_release);
+    _batches.fetch_add(1, std::memory_order_relaxed);
+    for (record *slot : _batch) {
+      slot->status.store(state::DONE, std::memory_order_release);
+    }
+  }
+
+  // Publishes an operation and returns its result once some thread has
+  // applied it, rethrowing anything applying it threw.
+  bool submit(operation op, const T &value) {
+    record &slot = claim();
+    slot.op = op;
+    try {
+      slot.value.emplace(value);
+    } catch (...) {
+      slot.status.store(state::FREE, std::memory_order_release);
+      throw;
+    }
+    slot.result = false;
+    slot.status.store(state::PENDING, std::memory_order_release);
+    while (slot.status.load(std::memory_order_acquire) != state::DONE) {
+      if (_combiner.try_lock()) {
+        combine();
+        _combiner.unlock();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    bool result = slot.result;
+    std::exception_ptr error = std::move(slot.error);
+    slot.error = nullptr;
+    slot.value.reset();
+    slot.status.store(state::FREE, std::memory_order_release);
+    if (error)
+      std::rethrow_exception(error);
+    return result;
+  }
+
+public:
+  // Creates an empty list with slots for up to slots threads to publish at
+  // once (0 for two per core). Further threads wait for a free slot.
+  explicit combining_binary_tree_array_list(size_t slots = 0)
+      : _size(0), _batches(0) {
+    if (slots == 0)
+      slots = 2 * std::max(std::thread::hardware_concurrency(), 1u);
+    _record_count = slots;
+    _records = std::make_unique<record[]>(slots);
+    _batch.reserve(slots);
+  }
+
+  combining_binary_tree_array_list(const combining_binary_tree_array_list &) =
+      delete;
+  combining_binary_tree_array_list &
+  operator=(const combining_binary_tree_array_list &) = delete;
+
+  // Returns the number of items in the list after the latest batch.
+  size_t size() const noexcept {
+    return _size.load(std::memory_order_acquire);
+  }
+
+  // Returns if the list was empty after the latest batch.
+  bool empty() const noexcept { return !size(); }
+
+  // Returns the number of batches applied so far.
+  size_t batches() const noexcept {
+    return _batches.load(std::memory_order_relaxed);
+  }
+
+  // Inserts a value into the list in-order.
+  void insert(const T &value) { submit(operation::INSERT, value); }
+
+  // Removes an item from the list, returning whether said item was in the
+  // list.
+  bool remove(const T &value) { return submit(operation::REMOVE, value); }
+
+  // Checks if the list contains an item.
+  bool contains(const T &value) { return submit(operation::CONTAINS, value); }
+
+  // Calls f with the list while holding the combiner lock, so that no batch
+  // is applied until f returns, and returns a copy of what f returns.
+  template <class F> auto read(F f) {
+    std::lock_guard lock(_combiner);
+    return f(std::as_const(_list));
+  }
+}; // class combining_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_COMBINING_BINARY_TREE_ARRAY_LIST_H
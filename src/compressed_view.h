@@ -0,0 +1,219 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_COMPRESSED_VIEW_H
+#define IMDAST_COMPRESSED_VIEW_H
+
+#include "binary_tree_array_list.h"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace imdast {
+// A read-only copy of a binary_tree_array_list of integers that stores each
+// key in as few bytes as its neighbourhood allows. The items are laid out as a
+// perfectly balanced tree, as from_sorted() lays them out, which is cut into
+// blocks of block_height levels counted from the bottom, so that only the top
+// block may be shorter. The keys of a subtree lie between the keys of its
+// ancestors, so deep blocks span narrow ranges, and each block stores its keys
+// as offsets from its smallest key, using just enough bytes for the largest
+// offset.
+//
+// The top block is block 0 and the blocks below its leaves are blocks 1 to
+// r. Every other block has block_keys + 1 children, numbered level by level:
+// the child below leaf slot j of block b > 0 is block
+// r + 1 + (block_keys + 1) * (b - 1) + j.
+template <class T> class compressed_view {
+  static_assert(std::is_integral_v<T>, "Keys must be integers");
+
+public:
+  // Number of tree levels per block.
+  static constexpr size_t block_height = 4;
+  // Number of keys per block.
+  static constexpr size_t block_keys = (size_t(1) << block_height) - 1;
+
+private:
+  using unsigned_type = std::make_unsigned_t<T>;
+
+  // Packed into two words at most, since there is one block per few keys.
+  struct block {
+    // The smallest key in the block.
+    T base;
+    // Position of the block's offsets in _bytes.
+    uint64_t offset : 44;
+    // Bit i is set if slot i of the block holds a key.
+    uint64_t present : 16;
+    // Bytes per offset, from 0 if every key equals base to sizeof(T).
+    uint64_t width : 4;
+  };
+  static_assert(block_keys <= 16, "Presence bits must fit in a uint16_t");
+
+  std::vector<block> _blocks;
+  // Number of keys in the top block.
+  size_t _top_keys;
+  // Offsets of every block, padded so that a whole word can be read past any
+  // of them.
+  std::vector<unsigned char> _bytes;
+  size_t _size;
+
+  // Returns the level-order index in a tree of slot local of the block rooted
+  // at index root.
+  static size_t slot_index(size_t root, size_t local) noexcept {
+    size_t depth = std::bit_width(local + 1) - 1;
+    return ((root + 1) << depth) + (local + 1 - (size_t(1) << depth)) - 1;
+  }
+
+  // Returns the key in slot local of a block. Offsets are stored least
+  // significant byte first; on little-endian machines, they are read as one
+  // word.
+  T key(const block &source, size_t local) const noexcept {
+    const unsigned char *bytes =
+        _bytes.data() + source.offset + local * source.width;
+    uint64_t raw = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+      std::memcpy(&raw, bytes, sizeof(raw));
+      if (source.width < sizeof(raw))
+        raw &= (uint64_t(1) << (source.width * 8)) - 1;
+    } else {
+      for (size_t i = 0; i < source.width; i++) {
+        raw |= uint64_t(bytes[i]) << (i * 8);
+      }
+    }
+    return static_cast<T>(static_cast<unsigned_type>(source.base) +
+                          static_cast<unsigned_type>(raw));
+  }
+
+  // Returns the number of the block below leaf slot j of block id.
+  size_t child(size_t id, size_t j) const noexcept {
+    return id == 0 ? 1 + j : _top_keys + 2 + (block_keys + 1) * (id - 1) + j;
+  }
+
+  // Encodes the block of the given number of keys rooted at index root of
+  // list as block number id, then the blocks below it.
+  void encode(const binary_tree_array_list<T> &list, size_t root, size_t id,
+              size_t keys_in_block) {
+    T keys[block_keys] = {};
+    block target{list._data[root].value(), _bytes.size(), 0, 0};
+    uint16_t present = 0;
+    for (size_t local = 0; local < keys_in_block; local++) {
+      size_t index = slot_index(root, local);
+      if (index < list._capacity && list._data[index].has_value()) {
+        keys[local] = list._data[index].value();
+        present |= uint16_t(1) << local;
+        target.base = std::min(target.base, keys[local]);
+      }
+    }
+    target.present = present;
+    unsigned_type span = 0;
+    for (size_t local = 0; local < keys_in_block; local++) {
+      if (target.present >> local & 1)
+        span = std::max<unsigned_type>(
+            span, static_cast<unsigned_type>(keys[local]) -
+                      static_cast<unsigned_type>(target.base));
+    }
+    target.width = static_cast<uint8_t>((std::bit_width(span) + 7) / 8);
+    // With a width of 0, every key equals base and nothing is stored.
+    _bytes.resize(_bytes.size() + keys_in_block * target.width);
+    for (size_t local = 0; target.width && local < keys_in_block; local++) {
+      if (target.present >> local & 1) {
+        uint64_t raw = static_cast<unsigned_type>(keys[local]) -
+                       static_cast<unsigned_type>(target.base);
+        unsigned char *bytes =
+            _bytes.data() + target.offset + local * target.width;
+        for (size_t i = 0; i < target.width; i++) {
+          bytes[i] = static_cast<unsigned char>(raw >> (i * 8));
+        }
+      }
+    }
+    if (id >= _blocks.size())
+      _blocks.resize(id + 1, block{T(), 0, 0, 0});
+    _blocks[id] = target;
+
+    // The children of the block's bottom level root the blocks below it.
+    size_t first_leaf = keys_in_block / 2;
+    for (size_t leaf = first_leaf; leaf < keys_in_block; leaf++) {
+      size_t index = slot_index(root, leaf);
+      for (size_t side = 0; side < 2; side++) {
+        size_t below = LEFT(index) + side;
+        if (below < list._capacity && list._data[below].has_value())
+          encode(list, below, child(id, (leaf - first_leaf) * 2 + side),
+                 block_keys);
+      }
+    }
+  }
+
+public:
+  // Creates an empty view.
+  compressed_view() noexcept : _top_keys(0), _size(0) {}
+
+  // Copies and compresses the items of list. Runs in O(n). Later changes to
+  // list are not reflected.
+  explicit compressed_view(const binary_tree_array_list<T> &list)
+      : _top_keys(0), _size(list._size) {
+    if (_size) {
+      auto balanced = binary_tree_array_list<T>::from_sorted(list.to_vector());
+      size_t height = balanced._height[0];
+      _top_keys = (size_t(1) << (height - (height - 1) / block_height *
+                                               block_height)) -
+                  1;
+      encode(balanced, 0, 0, _top_keys);
+    }
+    _bytes.resize(_bytes.size() + sizeof(uint64_t));
+  }
+
+  // Returns the number of items in the view.
+  size_t size() const noexcept { return _size; }
+
+  // Returns if the view is empty.
+  bool empty() const noexcept { return !_size; }
+
+  // Returns the number of bytes the view's blocks and offsets take up.
+  size_t bytes() const noexcept {
+    return _blocks.size() * sizeof(block) + _bytes.size();
+  }
+
+  // Checks if the view contains an item.
+  bool contains(const T &value) const noexcept {
+    size_t id = 0;
+    size_t keys_in_block = _top_keys;
+    while (id < _blocks.size()) {
+      const block &source = _blocks[id];
+      size_t local = 0;
+      while (local < keys_in_block) {
+        if (!(source.present >> local & 1))
+          return false;
+        T item = key(source, local);
+        if (item == value)
+          return true;
+        local = LEFT(local) + (item < value);
+      }
+      id = child(id, local - keys_in_block);
+      keys_in_block = block_keys;
+    }
+    return false;
+  }
+}; // class compressed_view
+} // namespace imdast
+
+#endif // IMDAST_COMPRESSED_VIEW_H
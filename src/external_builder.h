@@ -0,0 +1,525 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_EXTERNAL_BUILDER_H
+#define IMDAST_EXTERNAL_BUILDER_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace imdast {
+// The first bytes of a snapshot file. The header is followed by capacity items,
+// padded to the item alignment, then by capacity heights, where a height of 0
+// marks an empty slot. Slots are in the order binary_tree_array_list keeps
+// them.
+struct snapshot_header {
+  char magic[8];
+  uint64_t item_size;
+  uint64_t size;
+  uint64_t capacity;
+};
+
+inline constexpr char snapshot_magic[8] = {'I', 'M', 'D', 'B',
+                                           'T', 'A', 'L', '1'};
+
+// Returns the offset of the items in a snapshot of items of type T.
+template <class T> constexpr size_t snapshot_items_offset() {
+  return (sizeof(snapshot_header) + alignof(T) - 1) / alignof(T) * alignof(T);
+}
+
+// Throws a std::system_error for the current errno, first closing fd if it is
+// not negative.
+[[noreturn]] inline void throw_errno(const char *what, int fd = -1) {
+  int error = errno;
+  if (fd >= 0)
+    close(fd);
+  throw std::system_error(error, std::generic_category(), what);
+}
+
+// A read-only snapshot file of a binary_tree_array_list of trivially copyable
+// items, mapped into memory rather than read, so that lookups only page in the
+// slots they visit.
+template <class T> class mapped_snapshot {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Snapshot items must be trivially copyable");
+
+  void *_map;
+  size_t _length;
+  const T *_items;
+  const uint8_t *_heights;
+  size_t _size;
+  size_t _capacity;
+
+public:
+  // Maps the snapshot at path. Throws a std::system_error if it cannot be
+  // opened or mapped, and a std::logic_error if it is not a snapshot of items
+  // of type T.
+  explicit mapped_snapshot(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw_errno("Could not open snapshot");
+    off_t length = lseek(fd, 0, SEEK_END);
+    if (length < 0)
+      throw_errno("Could not read snapshot", fd);
+    if (static_cast<size_t>(length) < sizeof(snapshot_header)) {
+      close(fd);
+      throw std::logic_error("Snapshot is truncated");
+    }
+    _length = length;
+    _map = mmap(nullptr, _length, PROT_READ, MAP_SHARED, fd, 0);
+    if (_map == MAP_FAILED)
+      throw_errno("Could not map snapshot", fd);
+    close(fd);
+
+    snapshot_header header;
+    std::memcpy(&header, _map, sizeof(header));
+    size_t items = snapshot_items_offset<T>();
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) ||
+        header.item_size != sizeof(T) || header.size > header.capacity ||
+        _length != items + header.capacity * (sizeof(T) + 1)) {
+      munmap(_map, _length);
+      throw std::logic_error("Not a snapshot of items of this type");
+    }
+    _size = header.size;
+    _capacity = header.capacity;
+    _items = reinterpret_cast<const T *>(static_cast<char *>(_map) + items);
+    _heights = reinterpret_cast<const uint8_t *>(_items + _capacity);
+  }
+
+  mapped_snapshot(const mapped_snapshot &) = delete;
+  mapped_snapshot &operator=(const mapped_snapshot &) = delete;
+
+  ~mapped_snapshot() { munmap(_map, _length); }
+
+  // Returns the number of items in the snapshot.
+  size_t size() const noexcept { return _size; }
+
+  // Returns if the snapshot is empty.
+  bool empty() const noexcept { return !_size; }
+
+  // Checks if the snapshot contains an item.
+  bool contains(const T &value) const noexcept {
+    size_t index = 0;
+    while (index < _capacity && _heights[index]) {
+      if (_items[index] == value)
+        return true;
+      index = value < _items[index] ? LEFT(index) : RIGHT(index);
+    }
+    return false;
+  }
+
+  // Reads the whole snapshot into a list, keeping its layout.
+  binary_tree_array_list<T> to_list() const {
+    binary_tree_array_list<T> list;
+    list.reallocate(_capacity);
+    for (size_t i = 0; i < _capacity; i++) {
+      if (_heights[i])
+        list._data[i].emplace(_items[i]);
+    }
+    if (_capacity)
+      std::memcpy(list._height, _heights, _capacity);
+    list._size = _size;
+    list.refresh_extremes();
+    return list;
+  }
+}; // class mapped_snapshot
+
+// Builds a snapshot file of a perfectly balanced binary_tree_array_list from
+// unsorted trivially copyable items, using a bounded amount of memory however
+// many items there are. Items are collected into sorted runs that are spilled
+// to temporary files, the runs are merged, and the merged items are written
+// straight to their slots in the memory-mapped snapshot.
+template <class T> class external_builder {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Items must be trivially copyable");
+
+  using file = std::unique_ptr<FILE, int (*)(FILE *)>;
+
+  // Reads the items of one sorted run through a buffer. The run stays owned by
+  // the builder.
+  struct run_reader {
+    FILE *run;
+    std::vector<T> buffer;
+    size_t position = 0;
+
+    run_reader(FILE *run, size_t buffer_items)
+        : run(run), buffer(buffer_items) {
+      buffer.clear();
+    }
+
+    // Stores the next item in item, returning false once the run is
+    // exhausted.
+    bool next(T &item) {
+      if (position == buffer.size()) {
+        buffer.resize(buffer.capacity());
+        size_t count =
+            std::fread(buffer.data(), sizeof(T), buffer.size(), run);
+        if (std::ferror(run))
+          throw_errno("Could not read run");
+        buffer.resize(count);
+        position = 0;
+        if (count == 0)
+          return false;
+      }
+      item = buffer[position++];
+      return true;
+    }
+  };
+
+  std::string _directory;
+  size_t _run_items;
+  size_t _fan_in;
+  std::vector<T> _buffer;
+  std::vector<file> _runs;
+  // How many merges each run has been through. Never increases from the
+  // oldest run to the newest.
+  std::vector<size_t> _levels;
+  size_t _size;
+
+  // Creates an anonymous temporary file in the builder's directory, which is
+  // deleted as soon as it is closed.
+  file temporary() const {
+    std::string path = _directory + "/imdast-run-XXXXXX";
+    int fd = mkstemp(path.data());
+    if (fd < 0)
+      throw_errno("Could not create run");
+    unlink(path.c_str());
+    FILE *stream = fdopen(fd, "w+b");
+    if (!stream)
+      throw_errno("Could not create run", fd);
+    return file(stream, &std::fclose);
+  }
+
+  // Writes count items to a run, throwing on failure.
+  static void write(FILE *run, const T *items, size_t count) {
+    if (std::fwrite(items, sizeof(T), count, run) != count)
+      throw_errno("Could not write run");
+  }
+
+  // Sorts the buffered items and spills them to a new run.
+  void spill() {
+    if (_buffer.empty())
+      return;
+    std::sort(_buffer.begin(), _buffer.end());
+    file run = temporary();
+    write(run.get(), _buffer.data(), _buffer.size());
+    std::rewind(run.get());
+    _runs.push_back(std::move(run));
+    _levels.push_back(0);
+    _buffer.clear();
+    limit_runs();
+  }
+
+  // Merges sorted runs, producing their items in order.
+  class merger {
+    using head = std::pair<T, size_t>;
+    struct greater {
+      bool operator()(const head &a, const head &b) const {
+        return b.first < a.first;
+      }
+    };
+
+    std::vector<run_reader> _readers;
+    std::priority_queue<head, std::vector<head>, greater> _heads;
+
+  public:
+    merger(const file *first, const file *last, size_t buffer_items) {
+      for (const file *run = first; run != last; run++) {
+        _readers.emplace_back(run->get(), buffer_items);
+      }
+      T item;
+      for (size_t i = 0; i < _readers.size(); i++) {
+        if (_readers[i].next(item))
+          _heads.emplace(item, i);
+      }
+    }
+
+    // Stores the next item in item, returning false once every run is
+    // exhausted.
+    bool next(T &item) {
+      if (_heads.empty())
+        return false;
+      size_t source = _heads.top().second;
+      item = _heads.top().first;
+      _heads.pop();
+      T following;
+      if (_readers[source].next(following))
+        _heads.emplace(following, source);
+      return true;
+    }
+  };
+
+  // Returns how many items each of count runs may buffer while they are
+  // merged, splitting the memory budget between them.
+  size_t merge_buffer_items(size_t count) const {
+    return std::max<size_t>(1, _run_items / (count + 1));
+  }
+
+  // Merges the runs in [first, last) into one new run.
+  file merge_runs(const file *first, const file *last) const {
+    size_t buffer_items = merge_buffer_items(last - first);
+    file run = temporary();
+    merger source(first, last, buffer_items);
+    std::vector<T> output;
+    output.reserve(buffer_items);
+    T item;
+    while (source.next(item)) {
+      output.push_back(item);
+      if (output.size() == output.capacity()) {
+        write(run.get(), output.data(), output.size());
+        output.clear();
+      }
+    }
+    write(run.get(), output.data(), output.size());
+    std::rewind(run.get());
+    return run;
+  }
+
+  // Once fan_in runs are open, merges the newest runs of the lowest level into
+  // one, along with the level above if only one run is that low, so that no
+  // more than fan_in files are ever open. Runs of one level are about the same
+  // size, so with the default fan_in, even 100,000 runs merge each item about
+  // three times; a small fan_in merges items many more times.
+  void limit_runs() {
+    if (_runs.size() < _fan_in)
+      return;
+    size_t first = _runs.size() - 1;
+    while (first > 0 && _levels[first - 1] == _levels.back()) {
+      first--;
+    }
+    if (first == _runs.size() - 1) {
+      size_t level = _levels[first - 1];
+      while (first > 0 && _levels[first - 1] == level) {
+        first--;
+      }
+    }
+    size_t level = _levels[first] + 1;
+    // Release the run buffer so that the merge has the whole budget.
+    _buffer = std::vector<T>();
+    file run(nullptr, &std::fclose);
+    try {
+      run = merge_runs(_runs.data() + first, _runs.data() + _runs.size());
+    } catch (...) {
+      // Keep the runs, read from the start again, for a later merge.
+      for (size_t i = first; i < _runs.size(); i++) {
+        std::rewind(_runs[i].get());
+      }
+      throw;
+    }
+    _runs.erase(_runs.begin() + first, _runs.end());
+    _levels.resize(first);
+    _runs.push_back(std::move(run));
+    _levels.push_back(level);
+  }
+
+  // Writes a snapshot of size items, which next stores in its argument in
+  // order, returning false if it runs out, laid out as
+  // binary_tree_array_list::from_sorted() would lay them out.
+  template <class Next>
+  static void write_snapshot(const std::string &path, size_t size,
+                             Next next) {
+    size_t capacity = (size_t(1) << std::bit_width(size)) - 1;
+    size_t items_offset = snapshot_items_offset<T>();
+    size_t heights_offset = items_offset + capacity * sizeof(T);
+    size_t length = heights_offset + capacity;
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      throw_errno("Could not create snapshot");
+    if (ftruncate(fd, length) != 0)
+      throw_errno("Could not size snapshot", fd);
+    void *map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                     0);
+    if (map == MAP_FAILED)
+      throw_errno("Could not map snapshot", fd);
+    close(fd);
+    try {
+      fill_snapshot(map, size, capacity, next);
+    } catch (...) {
+      munmap(map, length);
+      throw;
+    }
+    int synced = msync(map, length, MS_SYNC);
+    munmap(map, length);
+    if (synced != 0)
+      throw_errno("Could not write snapshot");
+  }
+
+  // Fills a mapped snapshot of size items, which next produces in order.
+  template <class Next>
+  static void fill_snapshot(void *map, size_t size, size_t capacity,
+                            Next next) {
+    snapshot_header header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.item_size = sizeof(T);
+    header.size = size;
+    header.capacity = capacity;
+    std::memcpy(map, &header, sizeof(header));
+    char *items = static_cast<char *>(map) + snapshot_items_offset<T>();
+    uint8_t *heights = reinterpret_cast<uint8_t *>(items) + capacity * sizeof(T);
+
+    // Walks the slots of the balanced layout in order, keeping only the path
+    // from the root: the subtree at index holding count items has its root at
+    // in-order position count / 2.
+    std::vector<std::pair<size_t, size_t>> path_to;
+    auto descend = [&path_to](size_t index, size_t count) {
+      while (count > 0) {
+        path_to.emplace_back(index, count);
+        index = LEFT(index);
+        count /= 2;
+      }
+    };
+    descend(0, size);
+    T item{};
+    while (!path_to.empty()) {
+      auto [index, count] = path_to.back();
+      path_to.pop_back();
+      if (!next(item))
+        throw std::logic_error("Items ran out before the snapshot was full");
+      std::memcpy(items + index * sizeof(T), &item, sizeof(T));
+      heights[index] = static_cast<uint8_t>(std::bit_width(count));
+      descend(RIGHT(index), count - count / 2 - 1);
+    }
+  }
+
+public:
+  // Creates a builder that spills runs to directory and buffers up to
+  // memory_bytes of items at a time. At most fan_in runs are kept open: once
+  // that many have been spilled, the newest are merged into one. Throws a
+  // std::logic_error if the budget holds no item or fan_in is less than 2.
+  explicit external_builder(std::string directory = "/tmp",
+                            size_t memory_bytes = size_t(64) << 20,
+                            size_t fan_in = 64)
+      : _directory(std::move(directory)), _run_items(memory_bytes / sizeof(T)),
+        _fan_in(fan_in), _size(0) {
+    if (_run_items == 0)
+      throw std::logic_error("Memory budget is smaller than an item");
+    if (fan_in < 2)
+      throw std::logic_error("Runs must be merged at least two at a time");
+  }
+
+  // Returns the number of items added so far.
+  size_t size() const noexcept { return _size; }
+
+  // Returns the number of runs spilled so far.
+  size_t runs() const noexcept { return _runs.size(); }
+
+  // Adds an item, spilling a run if the memory budget is full.
+  void add(const T &item) {
+    if (_buffer.size() == _run_items)
+      spill();
+    if (_buffer.capacity() == 0)
+      _buffer.reserve(_run_items);
+    _buffer.push_back(item);
+    _size++;
+  }
+
+  // Adds every item read from fd until end of file, as raw records of
+  // sizeof(T) bytes. Throws a std::system_error if reading fails and a
+  // std::logic_error if the input ends partway through an item.
+  void add_records(int fd) {
+    std::vector<char> chunk(std::max<size_t>(sizeof(T), 1 << 16) /
+                            sizeof(T) * sizeof(T));
+    size_t filled = 0;
+    while (true) {
+      ssize_t count = read(fd, chunk.data() + filled, chunk.size() - filled);
+      if (count < 0) {
+        if (errno == EINTR)
+          continue;
+        throw_errno("Could not read records");
+      }
+      if (count == 0)
+        break;
+      filled += count;
+      size_t whole = filled / sizeof(T) * sizeof(T);
+      T item;
+      for (size_t offset = 0; offset < whole; offset += sizeof(T)) {
+        std::memcpy(&item, chunk.data() + offset, sizeof(T));
+        add(item);
+      }
+      std::memmove(chunk.data(), chunk.data() + whole, filled - whole);
+      filled -= whole;
+    }
+    if (filled)
+      throw std::logic_error("Input ends partway through an item");
+  }
+
+  // Adds every item in the file at path. See add_records(int).
+  void add_records(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw_errno("Could not open records");
+    try {
+      add_records(fd);
+    } catch (...) {
+      close(fd);
+      throw;
+    }
+    close(fd);
+  }
+
+  // Writes a snapshot of every item added so far to path, which
+  // mapped_snapshot can map, and leaves the builder empty.
+  void build(const std::string &path) {
+    size_t size = _size;
+    if (_runs.empty()) {
+      std::sort(_buffer.begin(), _buffer.end());
+      size_t position = 0;
+      write_snapshot(path, size, [this, &position](T &item) {
+        item = _buffer[position++];
+        return true;
+      });
+    } else {
+      spill();
+      // Release the run buffer so that the merge has the whole budget.
+      _buffer = std::vector<T>();
+      size_t buffer_items = merge_buffer_items(_runs.size());
+      merger source(_runs.data(), _runs.data() + _runs.size(), buffer_items);
+      write_snapshot(path, size,
+                     [&source](T &item) { return source.next(item); });
+    }
+    _runs.clear();
+    _levels.clear();
+    _buffer = std::vector<T>();
+    _size = 0;
+  }
+}; // class external_builder
+} // namespace imdast
+
+#endif // IMDAST_EXTERNAL_BUILDER_H
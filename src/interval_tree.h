@@ -0,0 +1,145 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_INTERVAL_TREE_H
+#define IMDAST_INTERVAL_TREE_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace imdast {
+// A closed interval [start, end]. Intervals are ordered by start, then by end.
+template <class K> struct interval {
+  K start;
+  K end;
+
+  bool operator<(const interval &other) const {
+    if (start < other.start)
+      return true;
+    if (other.start < start)
+      return false;
+    return end < other.end;
+  }
+
+  bool operator==(const interval &other) const {
+    return start == other.start && end == other.end;
+  }
+};
+
+// A set of intervals that answers which of them overlap a point or another
+// interval. The intervals are kept in a binary_tree_array_list ordered by
+// start, augmented with the greatest end in every subtree, so a query skips any
+// subtree that ends before the query starts or that starts after it ends.
+// Reports k overlapping intervals in O(min(n, k log n)): every subtree that is
+// entered holds at least one of them, but the paths down to different ones
+// need not be shared.
+template <class K> class interval_tree {
+  // Keeps the greatest end of a subtree.
+  struct max_end_augmentation {
+    using value_type = K;
+    static value_type identity() { return std::numeric_limits<K>::lowest(); }
+    static value_type lift(const interval<K> &item) { return item.end; }
+    static value_type combine(const value_type &left, const value_type &right) {
+      return std::max(left, right);
+    }
+  };
+
+  binary_tree_array_list<interval<K>, max_end_augmentation> _tree;
+
+  // Appends the intervals in the subtree rooted at index that overlap
+  // [lo, hi] to result, in order.
+  void collect(size_t index, const K &lo, const K &hi,
+               std::vector<interval<K>> &result) const {
+    while (index < _tree._capacity && _tree._data[index].has_value()) {
+      if (_tree._aggregate[index] < lo)
+        return;
+      collect(LEFT(index), lo, hi, result);
+      const interval<K> &item = *_tree._data[index];
+      // Everything to the right starts at or after this interval.
+      if (hi < item.start)
+        return;
+      if (!(item.end < lo))
+        result.push_back(item);
+      index = RIGHT(index);
+    }
+  }
+
+public:
+  // Creates an empty interval tree.
+  interval_tree() noexcept = default;
+
+  // Returns the number of intervals in the tree.
+  size_t size() const noexcept { return _tree.size(); }
+
+  // Returns if the tree is empty.
+  bool empty() const noexcept { return _tree.empty(); }
+
+  // Removes all intervals from the tree.
+  void clear() { _tree.clear(); }
+
+  // Adds an interval. Throws a std::logic_error if it ends before it starts.
+  void insert(const interval<K> &item) {
+    if (item.end < item.start)
+      throw std::logic_error("Interval ends before it starts");
+    _tree.insert(item);
+  }
+
+  // Removes an interval, returning whether it was in the tree.
+  bool remove(const interval<K> &item) { return _tree.remove(item); }
+
+  // Checks if the tree contains an interval.
+  bool contains(const interval<K> &item) const noexcept {
+    return _tree.contains(item);
+  }
+
+  // Returns the greatest end of any interval, or the lowest value of K if the
+  // tree is empty.
+  K max_end() const { return _tree.aggregate(); }
+
+  // Returns the intervals that contain point, ordered by start.
+  std::vector<interval<K>> overlapping(const K &point) const {
+    return overlapping(point, point);
+  }
+
+  // Returns the intervals that share at least one point with [lo, hi],
+  // ordered by start.
+  std::vector<interval<K>> overlapping(const K &lo, const K &hi) const {
+    std::vector<interval<K>> result;
+    collect(0, lo, hi, result);
+    return result;
+  }
+
+  // Returns the intervals that share at least one point with range, ordered by
+  // start.
+  std::vector<interval<K>> overlapping(const interval<K> &range) const {
+    return overlapping(range.start, range.end);
+  }
+
+  // Returns every interval, ordered by start.
+  std::vector<interval<K>> to_vector() const { return _tree.to_vector(); }
+}; // class interval_tree
+} // namespace imdast
+
+#endif // IMDAST_INTERVAL_TREE_H
@@ -0,0 +1,453 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_PACKED_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_PACKED_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace imdast {
+// A binary tree array list of trivially copyable items that keeps 2 bits of
+// metadata per slot instead of an optional and a height byte. The 2 bits say
+// whether the slot is empty and, if not, the node's balance factor, so the
+// slot array holds bare items and each byte of metadata covers 4 slots.
+// Inserts and removes retrace with the textbook AVL balance factor updates,
+// stopping as soon as a subtree's height is known not to have changed. With
+// distinct items, the tree takes exactly the shape a binary_tree_array_list
+// would; an item equal to others may land on the other side of them. The
+// height of a subtree, which shift() needs, is found by walking down its
+// taller side.
+template <class T> class packed_binary_tree_array_list {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Packed items must be trivially copyable");
+
+  // Slot states. The balance factor of an occupied slot is its state minus
+  // BALANCED: the height of its right subtree minus that of its left.
+  static constexpr uint8_t EMPTY = 0;
+  static constexpr uint8_t LEFT_HEAVY = 1;
+  static constexpr uint8_t BALANCED = 2;
+  static constexpr uint8_t RIGHT_HEAVY = 3;
+
+  T *_data;
+  // State of slot i in bits 2 * (i + 1) and up: offsetting by one slot makes
+  // every level of 4 or more slots start on a byte boundary.
+  uint8_t *_state;
+  size_t _size;
+  size_t _capacity;
+
+  static size_t state_bytes(size_t capacity) noexcept {
+    return capacity ? (capacity + 4) / 4 : 0;
+  }
+
+  uint8_t state(size_t index) const noexcept {
+    return _state[(index + 1) / 4] >> ((index + 1) % 4 * 2) & 3;
+  }
+
+  void set_state(size_t index, uint8_t value) noexcept {
+    uint8_t &byte = _state[(index + 1) / 4];
+    unsigned shift = (index + 1) % 4 * 2;
+    byte = static_cast<uint8_t>((byte & ~(3u << shift)) | value << shift);
+  }
+
+  bool occupied(size_t index) const noexcept {
+    return index < _capacity && state(index) != EMPTY;
+  }
+
+  int balance(size_t index) const noexcept { return state(index) - BALANCED; }
+
+  void set_balance(size_t index, int balance) noexcept {
+    set_state(index, static_cast<uint8_t>(BALANCED + balance));
+  }
+
+  // Height of the subtree rooted at index, found by following the taller
+  // child of each node down to a leaf.
+  size_t height_at(size_t index) const noexcept {
+    size_t height = 0;
+    while (occupied(index)) {
+      height++;
+      index = balance(index) > 0 ? RIGHT(index) : LEFT(index);
+    }
+    return height;
+  }
+
+  // Grows the allocation to capacity slots. Throws std::bad_alloc on failure,
+  // leaving the list unchanged.
+  void grow(size_t capacity) {
+    size_t old_bytes = state_bytes(_capacity);
+    size_t new_bytes = state_bytes(capacity);
+    auto *state = static_cast<uint8_t *>(realloc(_state, new_bytes));
+    if (!state)
+      throw std::bad_alloc();
+    _state = state;
+    std::memset(_state + old_bytes, 0, new_bytes - old_bytes);
+    auto *data = static_cast<T *>(realloc(_data, capacity * sizeof(T)));
+    if (!data)
+      throw std::bad_alloc();
+    _data = data;
+    _capacity = capacity;
+  }
+
+  // Moves the subtree rooted at current so that it becomes rooted at
+  // current + shift_amount, a level at a time, states included. See
+  // binary_tree_array_list::shift().
+  void shift(size_t current, long long shift_amount) {
+    if (!occupied(current) || shift_amount == 0)
+      return;
+
+    size_t levels = height_at(current);
+    for (size_t step = 0; step < levels; step++) {
+      size_t level = shift_amount > 0 ? levels - step - 1 : step;
+      size_t width = size_t(1) << level;
+      size_t first = (current + 1) * width - 1;
+      size_t dest = first + shift_amount * static_cast<long long>(width);
+      if (first >= _capacity || dest >= _capacity)
+        continue;
+      size_t count = std::min({width, _capacity - first, _capacity - dest});
+      std::memcpy(_data + dest, _data + first, count * sizeof(T));
+      if (count == width && width >= 4) {
+        // Both runs start on a byte boundary and cover whole bytes.
+        std::memcpy(_state + (dest + 1) / 4, _state + (first + 1) / 4,
+                    width / 4);
+        std::memset(_state + (first + 1) / 4, 0, width / 4);
+        continue;
+      }
+      for (size_t i = 0; i < count; i++) {
+        set_state(dest + i, state(first + i));
+        set_state(first + i, EMPTY);
+      }
+    }
+  }
+
+  // Rotates the subtree rooted at x, whose balance factor has just become
+  // 2 * side, back into balance, moving items as
+  // binary_tree_array_list::rebalance() does. Returns whether the rotation
+  // left the subtree one level shorter than it was while unbalanced.
+  bool rebalance(size_t x, int side) {
+    if (side < 0) {
+      size_t y = LEFT(x);
+      int y_balance = balance(y);
+      if (y_balance <= 0) {
+        // Rotate right.
+        size_t z = LEFT(y);
+        std::swap(_data[x], _data[y]);
+        shift(RIGHT(x), RIGHT(RIGHT(x)) - RIGHT(x));
+        _data[RIGHT(x)] = _data[y];
+        set_state(RIGHT(x), BALANCED);
+        shift(RIGHT(y), 1);
+        shift(z, y - z);
+        set_balance(x, y_balance == 0 ? 1 : 0);
+        set_balance(RIGHT(x), y_balance == 0 ? -1 : 0);
+        return y_balance != 0;
+      }
+      // Rotate left-right.
+      size_t z = RIGHT(y);
+      int z_balance = balance(z);
+      shift(RIGHT(x), RIGHT(RIGHT(x)) - RIGHT(x));
+      _data[RIGHT(x)] = _data[x];
+      set_state(RIGHT(x), BALANCED);
+      _data[x] = _data[z];
+      set_state(z, EMPTY);
+      shift(RIGHT(z), LEFT(RIGHT(x)) - RIGHT(z));
+      shift(LEFT(z), z - LEFT(z));
+      set_balance(x, 0);
+      set_balance(LEFT(x), z_balance > 0 ? -1 : 0);
+      set_balance(RIGHT(x), z_balance < 0 ? 1 : 0);
+      return true;
+    }
+
+    size_t y = RIGHT(x);
+    int y_balance = balance(y);
+    if (y_balance >= 0) {
+      // Rotate left.
+      size_t z = RIGHT(y);
+      std::swap(_data[x], _data[y]);
+      shift(LEFT(x), LEFT(LEFT(x)) - LEFT(x));
+      _data[LEFT(x)] = _data[y];
+      set_state(LEFT(x), BALANCED);
+      shift(LEFT(y), -1);
+      shift(z, y - z);
+      set_balance(x, y_balance == 0 ? -1 : 0);
+      set_balance(LEFT(x), y_balance == 0 ? 1 : 0);
+      return y_balance != 0;
+    }
+    // Rotate right-left.
+    size_t z = LEFT(y);
+    int z_balance = balance(z);
+    shift(LEFT(x), LEFT(LEFT(x)) - LEFT(x));
+    _data[LEFT(x)] = _data[x];
+    set_state(LEFT(x), BALANCED);
+    _data[x] = _data[z];
+    set_state(z, EMPTY);
+    shift(LEFT(z), RIGHT(LEFT(x)) - LEFT(z));
+    shift(RIGHT(z), z - RIGHT(z));
+    set_balance(x, 0);
+    set_balance(LEFT(x), z_balance > 0 ? -1 : 0);
+    set_balance(RIGHT(x), z_balance < 0 ? 1 : 0);
+    return true;
+  }
+
+  // Walks up from index, whose subtree just grew by one level, updating
+  // balance factors until a subtree's height stops changing.
+  void retrace_insert(size_t index) {
+    while (index > 0) {
+      size_t parent = PARENT(index);
+      int updated = balance(parent) + (index % 2 ? -1 : 1);
+      if (updated == 2 || updated == -2) {
+        // An insert rotation restores the subtree's previous height.
+        rebalance(parent, updated / 2);
+        return;
+      }
+      set_balance(parent, updated);
+      if (updated == 0)
+        return;
+      index = parent;
+    }
+  }
+
+  // Walks up from index, whose subtree just shrank by one level, updating
+  // balance factors until a subtree's height stops changing.
+  void retrace_remove(size_t index) {
+    while (index > 0) {
+      size_t parent = PARENT(index);
+      int updated = balance(parent) + (index % 2 ? 1 : -1);
+      if (updated == 2 || updated == -2) {
+        if (!rebalance(parent, updated / 2))
+          return;
+      } else {
+        set_balance(parent, updated);
+        if (updated != 0)
+          return;
+      }
+      index = parent;
+    }
+  }
+
+  // Returns the index of the smallest item in the subtree rooted at index.
+  size_t leftmost(size_t index) const noexcept {
+    while (occupied(LEFT(index))) {
+      index = LEFT(index);
+    }
+    return index;
+  }
+
+  // Returns the index of the greatest item in the subtree rooted at index.
+  size_t rightmost(size_t index) const noexcept {
+    while (occupied(RIGHT(index))) {
+      index = RIGHT(index);
+    }
+    return index;
+  }
+
+  // Returns the index of the in-order successor of the item at index, or
+  // std::numeric_limits<size_t>::max() if it is the greatest item.
+  size_t next_index(size_t index) const noexcept {
+    if (occupied(RIGHT(index)))
+      return leftmost(RIGHT(index));
+    while (index > 0 && index % 2 == 0) {
+      index = PARENT(index);
+    }
+    return index == 0 ? std::numeric_limits<size_t>::max() : PARENT(index);
+  }
+
+  // Removes the item stored at index, which must be occupied.
+  void remove_at(size_t index) {
+    size_t vacated = RIGHT(index);
+    if (!occupied(vacated)) {
+      vacated = index;
+      set_state(index, EMPTY);
+      shift(LEFT(index), index - LEFT(index));
+    } else {
+      vacated = leftmost(vacated);
+      _data[index] = _data[vacated];
+      set_state(vacated, EMPTY);
+      shift(RIGHT(vacated), vacated - RIGHT(vacated));
+    }
+    retrace_remove(vacated);
+    _size--;
+  }
+
+public:
+  class iterator {
+    const packed_binary_tree_array_list *_list;
+    size_t _current;
+
+  public:
+    // Creates an iterator pointing to the slot at current, or past-the-last
+    // if current is std::numeric_limits<size_t>::max().
+    iterator(const packed_binary_tree_array_list *list, size_t current) noexcept
+        : _list(list), _current(current) {}
+
+    // Returns the value at the iterator's current position.
+    const T &operator*() const noexcept { return _list->_data[_current]; }
+
+    // Moves the iterator to the next item in the list.
+    iterator &operator++() noexcept {
+      _current = _list->next_index(_current);
+      return *this;
+    }
+
+    bool operator==(const iterator &iter) const noexcept {
+      return _list == iter._list && _current == iter._current;
+    }
+
+    bool operator!=(const iterator &iter) const noexcept {
+      return !(*this == iter);
+    }
+  }; // class iterator
+
+  // Creates an empty list.
+  packed_binary_tree_array_list() noexcept
+      : _data(nullptr), _state(nullptr), _size(0), _capacity(0) {}
+
+  // Creates a copy of the list.
+  packed_binary_tree_array_list(const packed_binary_tree_array_list &list)
+      : packed_binary_tree_array_list() {
+    if (list._capacity) {
+      grow(list._capacity);
+      std::memcpy(_data, list._data, _capacity * sizeof(T));
+      std::memcpy(_state, list._state, state_bytes(_capacity));
+    }
+    _size = list._size;
+  }
+
+  // Takes over the allocation of another list, leaving that list empty.
+  packed_binary_tree_array_list(packed_binary_tree_array_list &&list) noexcept
+      : _data(std::exchange(list._data, nullptr)),
+        _state(std::exchange(list._state, nullptr)),
+        _size(std::exchange(list._size, 0)),
+        _capacity(std::exchange(list._capacity, 0)) {}
+
+  ~packed_binary_tree_array_list() noexcept {
+    free(_data);
+    free(_state);
+  }
+
+  // Replaces the contents of the list with a copy of another list's.
+  packed_binary_tree_array_list &
+  operator=(const packed_binary_tree_array_list &right) {
+    if (this != &right) {
+      packed_binary_tree_array_list copy(right);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  // Moves the right list's allocation into the left, leaving the right empty.
+  packed_binary_tree_array_list &
+  operator=(packed_binary_tree_array_list &&right) noexcept {
+    if (this != &right) {
+      free(_data);
+      free(_state);
+      _data = std::exchange(right._data, nullptr);
+      _state = std::exchange(right._state, nullptr);
+      _size = std::exchange(right._size, 0);
+      _capacity = std::exchange(right._capacity, 0);
+    }
+    return *this;
+  }
+
+  // Returns the number of items in the list.
+  size_t size() const noexcept { return _size; }
+
+  // Returns the maximum number of items the list can contain without needing
+  // to reallocate.
+  size_t capacity() const noexcept { return _capacity; }
+
+  // Returns if the list is empty.
+  bool empty() const noexcept { return !_size; }
+
+  // Returns the height of the tree.
+  size_t height() const noexcept { return height_at(0); }
+
+  // Returns the number of bytes held by the slot and state arrays.
+  size_t bytes() const noexcept {
+    return _capacity * sizeof(T) + state_bytes(_capacity);
+  }
+
+  // Removes all items from the list. Does not shrink the list's allocation.
+  void clear() noexcept {
+    if (_capacity)
+      std::memset(_state, 0, state_bytes(_capacity));
+    _size = 0;
+  }
+
+  // Inserts a value into the list in-order.
+  void insert(const T &value) {
+    size_t index = 0;
+    while (occupied(index)) {
+      index = LEFT(index) + (_data[index] < value);
+    }
+    while (index >= _capacity) {
+      grow(LEFT(_capacity));
+    }
+    _data[index] = value;
+    set_state(index, BALANCED);
+    _size++;
+    retrace_insert(index);
+  }
+
+  // Removes an item from the list, returning whether said item was in the list.
+  bool remove(const T &value) {
+    size_t index = 0;
+    while (occupied(index)) {
+      if (_data[index] == value) {
+        remove_at(index);
+        return true;
+      }
+      index = value < _data[index] ? LEFT(index) : RIGHT(index);
+    }
+    return false;
+  }
+
+  // Checks if the list contains an item.
+  bool contains(const T &value) const noexcept {
+    size_t index = 0;
+    while (occupied(index)) {
+      if (value == _data[index])
+        return true;
+      index = value < _data[index] ? LEFT(index) : RIGHT(index);
+    }
+    return false;
+  }
+
+  // Creates an iterator pointing to the smallest item in the list.
+  iterator begin() const noexcept {
+    return iterator(this, _size ? leftmost(0)
+                                : std::numeric_limits<size_t>::max());
+  }
+
+  // Creates an iterator pointing to the past-the-last item.
+  iterator end() const noexcept {
+    return iterator(this, std::numeric_limits<size_t>::max());
+  }
+}; // class packed_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_PACKED_BINARY_TREE_ARRAY_LIST_H
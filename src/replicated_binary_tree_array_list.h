@@ -0,0 +1,325 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_REPLICATED_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_REPLICATED_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace imdast {
+// A binary_tree_array_list with one read-only replica per NUMA node. Each
+// replica is copied by a thread pinned to its node, so the kernel's first-touch
+// policy places its pages in that node's memory, and lookups are routed to the
+// replica of the node the calling thread is running on. Writes go to a primary
+// list and reach the replicas either immediately or in batches. A batch is
+// replayed on each replica by a thread pinned to its node, and a replica whose
+// allocation grows during an immediate write is copied again on its node.
+//
+// Lookups may run concurrently with each other and with one writer; writes
+// must not run concurrently with each other. Outside Linux, or when the node
+// topology cannot be read, there is a single replica.
+template <class T> class replicated_binary_tree_array_list {
+  enum class operation : uint8_t { INSERT, REMOVE, CLEAR };
+
+  // A write made to the primary list.
+  struct write {
+    operation op;
+    std::optional<T> value;
+  };
+
+  struct replica {
+    // CPUs of the replica's node.
+    std::vector<int> cpus;
+    binary_tree_array_list<T> list;
+    mutable std::shared_mutex mutex;
+  };
+
+  binary_tree_array_list<T> _primary;
+  std::vector<std::unique_ptr<replica>> _replicas;
+  // Maps a CPU to the replica of its node.
+  std::vector<size_t> _replica_of_cpu;
+  size_t _batch;
+  // Writes not yet applied to the replicas, oldest first.
+  std::vector<write> _log;
+
+  // Parses a sysfs CPU or node list such as "0-3,8,10-11".
+  static std::vector<int> parse_cpus(const std::string &text) {
+    std::vector<int> cpus;
+    size_t position = 0;
+    while (position < text.size()) {
+      size_t end = text.find(',', position);
+      if (end == std::string::npos)
+        end = text.size();
+      std::string range = text.substr(position, end - position);
+      size_t dash = range.find('-');
+      int first = std::stoi(range.substr(0, dash));
+      int last = dash == std::string::npos ? first
+                                           : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+      position = end + 1;
+    }
+    return cpus;
+  }
+
+  // Creates one replica per NUMA node with at least one CPU, or a single
+  // replica with no CPUs if the topology cannot be read.
+  void discover_nodes() {
+#ifdef __linux__
+    std::vector<int> nodes;
+    try {
+      std::ifstream online("/sys/devices/system/node/online");
+      std::string text;
+      if (std::getline(online, text))
+        nodes = parse_cpus(text);
+    } catch (...) {
+    }
+    for (int node : nodes) {
+      std::ifstream file("/sys/devices/system/node/node" +
+                         std::to_string(node) + "/cpulist");
+      std::string text;
+      std::vector<int> cpus;
+      try {
+        if (std::getline(file, text))
+          cpus = parse_cpus(text);
+      } catch (...) {
+      }
+      if (cpus.empty())
+        continue;
+      for (int cpu : cpus) {
+        if (static_cast<size_t>(cpu) >= _replica_of_cpu.size())
+          _replica_of_cpu.resize(cpu + 1, 0);
+        _replica_of_cpu[cpu] = _replicas.size();
+      }
+      _replicas.push_back(std::make_unique<replica>());
+      _replicas.back()->cpus = std::move(cpus);
+    }
+#endif
+    if (_replicas.empty()) {
+      _replicas.push_back(std::make_unique<replica>());
+      _replica_of_cpu.clear();
+    }
+  }
+
+  // Returns the replica of the node the calling thread is running on.
+  const replica &local() const noexcept {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < _replica_of_cpu.size())
+      return *_replicas[_replica_of_cpu[cpu]];
+#endif
+    return *_replicas.front();
+  }
+
+  // Calls f on a thread pinned to cpus and waits for it, rethrowing anything f
+  // throws.
+  template <class F> static void run_on(const std::vector<int> &cpus, F f) {
+    std::exception_ptr error;
+    std::jthread([&] {
+#ifdef __linux__
+      if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+          if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+        }
+        sched_setaffinity(0, sizeof(set), &set);
+      }
+#endif
+      try {
+        f();
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }).join();
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  // Returns a copy of the primary list with storage of its own, allocated and
+  // written by a thread pinned to cpus.
+  binary_tree_array_list<T> clone_on(const std::vector<int> &cpus) const {
+    binary_tree_array_list<T> copy;
+    run_on(cpus, [&] {
+      copy = _primary;
+      copy.detach();
+    });
+    return copy;
+  }
+
+  // Applies a logged write to list.
+  static void apply(binary_tree_array_list<T> &list, const write &change) {
+    switch (change.op) {
+    case operation::INSERT:
+      list.insert(*change.value);
+      break;
+    case operation::REMOVE:
+      list.remove(*change.value);
+      break;
+    case operation::CLEAR:
+      list.clear();
+      break;
+    }
+  }
+
+  // Applies a write to every replica if writes are synchronous, or publishes
+  // the log once a batch of writes has accumulated.
+  void propagate(write change) {
+    if (_batch == 0) {
+      for (auto &target : _replicas) {
+        size_t capacity = target->list.capacity();
+        {
+          std::unique_lock lock(target->mutex);
+          apply(target->list, change);
+        }
+        // The grown allocation was first touched by this thread, so its pages
+        // may sit on another node.
+        if (target->list.capacity() > capacity) {
+          binary_tree_array_list<T> copy = clone_on(target->cpus);
+          std::unique_lock lock(target->mutex);
+          std::swap(target->list, copy);
+        }
+      }
+      return;
+    }
+    if (change.op == operation::CLEAR)
+      _log.clear();
+    _log.push_back(std::move(change));
+    if (_log.size() >= _batch)
+      publish();
+  }
+
+public:
+  // Creates an empty list. With batch 0, every write is applied to every
+  // replica before it returns. Otherwise, lookups may miss up to batch - 1 of
+  // the latest writes, which are replayed on every replica once batch of them
+  // have accumulated.
+  explicit replicated_binary_tree_array_list(size_t batch = 0)
+      : _batch(batch) {
+    discover_nodes();
+  }
+
+  // Creates a list holding the same items as list.
+  explicit replicated_binary_tree_array_list(
+      const binary_tree_array_list<T> &list, size_t batch = 0)
+      : _primary(list), _batch(batch) {
+    discover_nodes();
+    for (auto &target : _replicas) {
+      target->list = clone_on(target->cpus);
+    }
+  }
+
+  replicated_binary_tree_array_list(const replicated_binary_tree_array_list &) =
+      delete;
+  replicated_binary_tree_array_list &
+  operator=(const replicated_binary_tree_array_list &) = delete;
+
+  // Returns the number of replicas, one per NUMA node.
+  size_t replica_count() const noexcept { return _replicas.size(); }
+
+  // Returns the number of writes not yet visible to lookups.
+  size_t pending() const noexcept { return _log.size(); }
+
+  // Returns the list that writes are applied to. It is always up to date, but
+  // must not be read concurrently with a write.
+  const binary_tree_array_list<T> &primary() const noexcept {
+    return _primary;
+  }
+
+  // Replays the pending writes on every replica, making them visible to
+  // lookups. Each replica is updated by a thread pinned to its node, in
+  // O(b log n) for b pending writes, and lookups on it wait until it is done.
+  void publish() {
+    for (auto &target : _replicas) {
+      run_on(target->cpus, [&] {
+        std::unique_lock lock(target->mutex);
+        for (const write &change : _log) {
+          apply(target->list, change);
+        }
+      });
+    }
+    _log.clear();
+  }
+
+  // Inserts a value into the list in-order.
+  void insert(const T &value) {
+    _primary.insert(value);
+    propagate({operation::INSERT, value});
+  }
+
+  // Removes an item from the list, returning whether said item was in the
+  // list.
+  bool remove(const T &value) {
+    if (!_primary.remove(value))
+      return false;
+    propagate({operation::REMOVE, value});
+    return true;
+  }
+
+  // Removes all items from the list.
+  void clear() {
+    _primary.clear();
+    propagate({operation::CLEAR, std::nullopt});
+  }
+
+  // Checks if the local replica contains an item.
+  bool contains(const T &value) const {
+    const replica &source = local();
+    std::shared_lock lock(source.mutex);
+    return source.list.contains(value);
+  }
+
+  // Returns the number of items in the local replica.
+  size_t size() const {
+    const replica &source = local();
+    std::shared_lock lock(source.mutex);
+    return source.list.size();
+  }
+
+  // Calls f with the local replica, which is not modified until f returns, and
+  // returns a copy of what f returns.
+  template <class F> auto read(F f) const {
+    const replica &source = local();
+    std::shared_lock lock(source.mutex);
+    return f(std::as_const(source.list));
+  }
+}; // class replicated_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_REPLICATED_BINARY_TREE_ARRAY_LIST_H
@@ -0,0 +1,200 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_S_TREE_VIEW_H
+#define IMDAST_S_TREE_VIEW_H
+
+#include "binary_tree_array_list.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace imdast {
+// A read-only, sorted snapshot of a binary_tree_array_list laid out as a
+// static B+ tree ("S+ tree") with 16 keys per node. With 4-byte keys a node is
+// exactly one cache line, and the child to descend into is the number of keys
+// in the node less than the search key, which is computed for all 16 keys at
+// once from a vector compare mask. The bottom layer is the sorted items
+// themselves, so ordered scans are a walk over a plain array.
+//
+// Node k of a layer has children 17k to 17k + 16 in the layer below, and its
+// key j is the smallest item below child 17k + j + 1. Missing keys are padded
+// with the greatest item, which no search for a smaller key descends past.
+template <class T> class s_tree_view {
+public:
+  // Number of keys per node.
+  static constexpr size_t node_size = 16;
+
+private:
+  // Allocates storage aligned to a cache line, so that nodes do not straddle
+  // two lines.
+  template <class U> struct cache_aligned_allocator {
+    using value_type = U;
+    static constexpr std::align_val_t alignment{64};
+
+    cache_aligned_allocator() noexcept = default;
+    template <class V>
+    cache_aligned_allocator(const cache_aligned_allocator<V> &) noexcept {}
+
+    U *allocate(size_t n) {
+      return static_cast<U *>(::operator new(n * sizeof(U), alignment));
+    }
+
+    void deallocate(U *p, size_t) noexcept {
+      ::operator delete(p, alignment);
+    }
+
+    bool operator==(const cache_aligned_allocator &) const noexcept {
+      return true;
+    }
+    bool operator!=(const cache_aligned_allocator &) const noexcept {
+      return false;
+    }
+  };
+
+  // Layer 0 holds the sorted items, padded to a whole number of nodes. Higher
+  // layers follow, with _offsets[h] the index of the first key of layer h.
+  std::vector<T, cache_aligned_allocator<T>> _keys;
+  std::vector<size_t> _offsets;
+  size_t _size;
+
+  // Returns the number of keys in the node starting at keys that are less
+  // than value.
+  static size_t count_less(const T *keys, const T &value) noexcept {
+#ifdef __AVX2__
+    if constexpr (std::is_same_v<T, int32_t>) {
+      __m256i x = _mm256_set1_epi32(value);
+      __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys));
+      __m256i high =
+          _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + 8));
+      uint32_t mask = static_cast<uint32_t>(
+          _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, low))) |
+          (_mm256_movemask_ps(
+               _mm256_castsi256_ps(_mm256_cmpgt_epi32(x, high)))
+           << 8));
+      return static_cast<size_t>(__builtin_popcount(mask));
+    }
+#endif
+    // Branch-free, so compilers vectorize it for arithmetic types.
+    size_t result = 0;
+    for (size_t i = 0; i < node_size; i++) {
+      result += keys[i] < value;
+    }
+    return result;
+  }
+
+public:
+  // Creates an empty view.
+  s_tree_view() noexcept : _size(0) {}
+
+  // Copies the items of list into a new static tree. Runs in O(n). Later
+  // changes to list are not reflected.
+  explicit s_tree_view(const binary_tree_array_list<T> &list)
+      : _size(list.size()) {
+    if (_size == 0)
+      return;
+
+    // Number of nodes in each layer, leaves first.
+    std::vector<size_t> nodes = {(_size + node_size - 1) / node_size};
+    while (nodes.back() > 1) {
+      nodes.push_back((nodes.back() + node_size) / (node_size + 1));
+    }
+    size_t total = 0;
+    for (size_t count : nodes) {
+      _offsets.push_back(total);
+      total += count * node_size;
+    }
+
+    _keys.reserve(total);
+    for (T item : list) {
+      _keys.push_back(item);
+    }
+    const T greatest = _keys.back();
+    _keys.resize(nodes[0] * node_size, greatest);
+
+    // The leftmost leaf node below node c of layer h - 1 is c * 17^(h - 1).
+    size_t span = 1;
+    for (size_t h = 1; h < nodes.size(); h++) {
+      for (size_t k = 0; k < nodes[h]; k++) {
+        for (size_t j = 0; j < node_size; j++) {
+          size_t leaf = (k * (node_size + 1) + j + 1) * span * node_size;
+          _keys.push_back(leaf < _size ? _keys[leaf] : greatest);
+        }
+      }
+      span *= node_size + 1;
+    }
+  }
+
+  // Returns the number of items in the view.
+  size_t size() const noexcept { return _size; }
+
+  // Returns if the view is empty.
+  bool empty() const noexcept { return !_size; }
+
+  // Returns the number of items less than value, which is also the position
+  // of lower_bound(value) in the ordered items.
+  size_t rank(const T &value) const noexcept {
+    if (_size == 0 || _keys[_size - 1] < value)
+      return _size;
+    size_t node = 0;
+    for (size_t h = _offsets.size() - 1; h > 0; h--) {
+      node = node * (node_size + 1) +
+             count_less(&_keys[_offsets[h] + node * node_size], value);
+    }
+    return node * node_size + count_less(&_keys[node * node_size], value);
+  }
+
+  // Checks if the view contains an item.
+  bool contains(const T &value) const noexcept {
+    size_t index = rank(value);
+    return index < _size && _keys[index] == value;
+  }
+
+  // Returns the smallest item not less than value, or nullopt if there is
+  // none.
+  std::optional<T> lower_bound(const T &value) const noexcept {
+    size_t index = rank(value);
+    if (index == _size)
+      return std::nullopt;
+    return _keys[index];
+  }
+
+  // Returns the nth (0-indexed) smallest item. index must be < size().
+  const T &operator[](size_t index) const noexcept { return _keys[index]; }
+
+  // Returns a pointer to the smallest item. The items are contiguous and in
+  // order up to end(), so ordered scans are plain pointer walks, e.g. from
+  // begin() + rank(low) to begin() + rank(high).
+  const T *begin() const noexcept { return _keys.data(); }
+
+  // Returns a pointer past the greatest item.
+  const T *end() const noexcept { return _keys.data() + _size; }
+}; // class s_tree_view
+} // namespace imdast
+
+#endif // IMDAST_S_TREE_VIEW_H
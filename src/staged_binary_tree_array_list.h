@@ -0,0 +1,210 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_STAGED_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_STAGED_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace imdast {
+// A binary_tree_array_list with a small staging buffer in front of it. Inserts
+// and removes are recorded in the buffer, which is kept sorted, without
+// touching the tree, and lookups binary-search the buffer as well as search the
+// tree. With b pending writes, each write costs O(log b) comparisons and
+// moves up to b items along one contiguous array. When the buffer fills, it is
+// merged into the tree with one linear pass that lays the tree out again as a
+// perfectly balanced tree, so bursts of random writes cost a sequential rebuild
+// instead of a shift per write.
+template <class T> class staged_binary_tree_array_list {
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  binary_tree_array_list<T> _tree;
+  // Items inserted since the last merge, in order.
+  std::vector<T> _inserts;
+  // Items of the tree removed since the last merge, in order.
+  std::vector<T> _removes;
+  size_t _buffer_capacity;
+
+  // Number of items in a sorted buffer equal to value.
+  static size_t count(const std::vector<T> &buffer, const T &value) {
+    auto [first, last] = std::equal_range(buffer.begin(), buffer.end(), value);
+    return last - first;
+  }
+
+  // Adds value to a sorted buffer, after any items equal to it.
+  static void add(std::vector<T> &buffer, const T &value) {
+    buffer.insert(std::upper_bound(buffer.begin(), buffer.end(), value), value);
+  }
+
+  // Returns whether the tree holds more than skip items equal to value.
+  bool tree_holds(const T &value, size_t skip) const noexcept {
+    size_t index = 0;
+    size_t first = npos;
+    while (index < _tree._capacity && _tree._data[index].has_value()) {
+      if (*_tree._data[index] < value) {
+        index = RIGHT(index);
+      } else {
+        first = index;
+        index = LEFT(index);
+      }
+    }
+    for (size_t i = 0; i <= skip; i++) {
+      if (first == npos || !(*_tree._data[first] == value))
+        return false;
+      first = _tree.next_index(first);
+    }
+    return true;
+  }
+
+  // Returns the items of the tree, minus the removes, merged with the inserts.
+  // Both must be in order.
+  std::vector<T> merged(const std::vector<T> &inserts,
+                        const std::vector<T> &removes,
+                        unsigned threads) const {
+    std::vector<T> items = _tree.to_vector(threads);
+    if (!removes.empty()) {
+      size_t kept = 0;
+      auto removed = removes.begin();
+      for (size_t i = 0; i < items.size(); i++) {
+        if (removed != removes.end() && *removed == items[i]) {
+          ++removed;
+        } else {
+          if (kept != i)
+            items[kept] = std::move(items[i]);
+          kept++;
+        }
+      }
+      items.erase(items.begin() + kept, items.end());
+    }
+    std::vector<T> result;
+    result.reserve(items.size() + inserts.size());
+    std::merge(std::make_move_iterator(items.begin()),
+               std::make_move_iterator(items.end()), inserts.begin(),
+               inserts.end(), std::back_inserter(result));
+    return result;
+  }
+
+  // Merges the buffer into the tree if it is full.
+  void maybe_flush() {
+    if (_inserts.size() + _removes.size() >= _buffer_capacity)
+      flush(1);
+  }
+
+public:
+  // Creates an empty list whose buffer holds up to buffer_capacity pending
+  // inserts and removes. Throws a std::logic_error if buffer_capacity is 0.
+  explicit staged_binary_tree_array_list(size_t buffer_capacity = 256)
+      : _buffer_capacity(buffer_capacity) {
+    if (buffer_capacity == 0)
+      throw std::logic_error("Buffer capacity must be positive");
+    _inserts.reserve(buffer_capacity);
+  }
+
+  // Returns the number of items in the list.
+  size_t size() const noexcept {
+    return _tree.size() + _inserts.size() - _removes.size();
+  }
+
+  // Returns if the list is empty.
+  bool empty() const noexcept { return !size(); }
+
+  // Returns the number of pending inserts and removes in the buffer.
+  size_t buffered() const noexcept {
+    return _inserts.size() + _removes.size();
+  }
+
+  // Returns the number of pending inserts and removes that trigger a merge.
+  size_t buffer_capacity() const noexcept { return _buffer_capacity; }
+
+  // Returns the tree holding every item not in the buffer.
+  const binary_tree_array_list<T> &tree() const noexcept { return _tree; }
+
+  // Removes all items from the list.
+  void clear() {
+    _tree.clear();
+    _inserts.clear();
+    _removes.clear();
+  }
+
+  // Inserts a value into the buffer, merging the buffer into the tree if it is
+  // full.
+  void insert(const T &value) {
+    add(_inserts, value);
+    maybe_flush();
+  }
+
+  // Removes an item from the list, returning whether said item was in the
+  // list. A pending insert of the item is cancelled; otherwise the remove is
+  // recorded in the buffer.
+  bool remove(const T &value) {
+    auto pending = std::lower_bound(_inserts.begin(), _inserts.end(), value);
+    if (pending != _inserts.end() && *pending == value) {
+      _inserts.erase(pending);
+      return true;
+    }
+    if (!tree_holds(value, count(_removes, value)))
+      return false;
+    add(_removes, value);
+    maybe_flush();
+    return true;
+  }
+
+  // Checks if the list contains an item.
+  bool contains(const T &value) const noexcept {
+    return std::binary_search(_inserts.begin(), _inserts.end(), value) ||
+           tree_holds(value, count(_removes, value));
+  }
+
+  // Merges the buffer into the tree, laying the tree out again as a perfectly
+  // balanced tree. Runs in O(n + b). With threads above 1 (or 0 for one
+  // per core), the merge is split across up to that many threads.
+  void flush(unsigned threads = 1) {
+    if (_inserts.empty() && _removes.empty())
+      return;
+    threads = binary_tree_array_list<T>::resolve_threads(threads);
+    _tree.assign_sorted(merged(_inserts, _removes, threads), threads);
+    _inserts.clear();
+    _removes.clear();
+  }
+
+  // Returns every item in the list, in order, without merging the buffer.
+  std::vector<T> to_vector() const { return merged(_inserts, _removes, 1); }
+
+  // Merges the buffer, then creates an iterator pointing to the smallest item.
+  typename binary_tree_array_list<T>::iterator begin() {
+    flush(1);
+    return _tree.begin();
+  }
+
+  // Creates an iterator pointing to the past-the-last item.
+  typename binary_tree_array_list<T>::iterator end() const noexcept {
+    return _tree.end();
+  }
+}; // class staged_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_STAGED_BINARY_TREE_ARRAY_LIST_H
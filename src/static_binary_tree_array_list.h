@@ -0,0 +1,191 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_STATIC_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_STATIC_BINARY_TREE_ARRAY_LIST_H
+
+#include "array_tree_base.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace imdast {
+// A binary tree array list whose storage is a fixed-size array inside the
+// object, for code that must never allocate. The tree can be at most MaxHeight
+// levels tall, and insert() reports failure instead of growing. A new item
+// starts as a leaf before any rebalancing, so how many items fit depends on the
+// order they arrive in: anywhere from the fewest an AVL tree of height
+// MaxHeight can hold (4 for a height of 3, 7 for 4, 12 for 5, ...) up to
+// max_capacity. Every operation is constexpr, so a small lookup table can be
+// built at compile time:
+//
+//   constexpr auto table = [] {
+//     static_binary_tree_array_list<int, 4> list;
+//     for (int port : {22, 80, 443})
+//       list.insert(port);
+//     return list;
+//   }();
+//   static_assert(table.contains(443));
+template <class T, size_t MaxHeight>
+class static_binary_tree_array_list
+    : public array_tree_base<static_binary_tree_array_list<T, MaxHeight>> {
+  friend class array_tree_base<static_binary_tree_array_list>;
+  static_assert(MaxHeight > 0 && MaxHeight < 32,
+                "MaxHeight must be between 1 and 31");
+
+public:
+  // Number of slots, and so the most items the list can ever contain.
+  static constexpr size_t max_capacity = (size_t(1) << MaxHeight) - 1;
+
+private:
+  std::array<std::optional<T>, max_capacity> _data{};
+  std::array<uint8_t, max_capacity> _height{};
+  size_t _size = 0;
+
+  using base = array_tree_base<static_binary_tree_array_list>;
+  using base::leftmost;
+  using base::next_index;
+  using base::remove_slot;
+  using base::retrace;
+
+  // Number of slots in the array.
+  static constexpr size_t slot_count() noexcept { return max_capacity; }
+
+  // Removes the item stored at index, which must be occupied.
+  constexpr void remove_at(size_t index) {
+    remove_slot(index);
+    _size--;
+  }
+
+public:
+  class iterator {
+    const static_binary_tree_array_list *_list;
+    size_t _current;
+
+  public:
+    // Creates an iterator pointing to the slot at current, or past-the-last
+    // if current is std::numeric_limits<size_t>::max().
+    constexpr iterator(const static_binary_tree_array_list *list,
+                       size_t current) noexcept
+        : _list(list), _current(current) {}
+
+    // Returns the value at the iterator's current position.
+    constexpr const T &operator*() const noexcept {
+      return *_list->_data[_current];
+    }
+
+    // Moves the iterator to the next item in the list.
+    constexpr iterator &operator++() noexcept {
+      _current = _list->next_index(_current);
+      return *this;
+    }
+
+    constexpr bool operator==(const iterator &iter) const noexcept {
+      return _list == iter._list && _current == iter._current;
+    }
+
+    constexpr bool operator!=(const iterator &iter) const noexcept {
+      return !(*this == iter);
+    }
+  }; // class iterator
+
+  // Creates an empty list.
+  constexpr static_binary_tree_array_list() noexcept = default;
+
+  // Returns the number of items in the list.
+  constexpr size_t size() const noexcept { return _size; }
+
+  // Returns the most items the list can contain.
+  static constexpr size_t capacity() noexcept { return max_capacity; }
+
+  // Returns if the list is empty.
+  constexpr bool empty() const noexcept { return !_size; }
+
+  // Removes all items from the list.
+  constexpr void clear() noexcept {
+    for (size_t i = 0; i < max_capacity; i++) {
+      _data[i].reset();
+      _height[i] = 0;
+    }
+    _size = 0;
+  }
+
+  // Inserts a value into the list in-order. Returns false, leaving the list
+  // unchanged, if the new leaf would land below the bottom level. Never
+  // allocates.
+  constexpr bool insert(const T &value) {
+    size_t index = 0;
+    while (index < max_capacity && _data[index].has_value()) {
+      index = LEFT(index) + (_data[index].value() < value);
+    }
+    if (index >= max_capacity)
+      return false;
+
+    _data[index] = value;
+    _height[index] = 1;
+    _size++;
+    retrace(index);
+    return true;
+  }
+
+  // Removes an item from the list, returning whether said item was in the list.
+  constexpr bool remove(const T &value) {
+    size_t index = 0;
+    while (index < max_capacity && _data[index].has_value()) {
+      if (_data[index].value() == value) {
+        remove_at(index);
+        return true;
+      }
+      index = value < _data[index].value() ? LEFT(index) : RIGHT(index);
+    }
+    return false;
+  }
+
+  // Checks if the list contains an item.
+  constexpr bool contains(const T &value) const noexcept {
+    size_t index = 0;
+    while (index < max_capacity && _data[index].has_value()) {
+      if (value == _data[index].value())
+        return true;
+      index = value < _data[index].value() ? LEFT(index) : RIGHT(index);
+    }
+    return false;
+  }
+
+  // Returns the height of the tree.
+  constexpr size_t height() const noexcept { return _size ? _height[0] : 0; }
+
+  // Creates an iterator pointing to the smallest item in the list.
+  constexpr iterator begin() const noexcept {
+    return iterator(this, _size ? leftmost(0)
+                                : std::numeric_limits<size_t>::max());
+  }
+
+  // Creates an iterator pointing to the past-the-last item.
+  constexpr iterator end() const noexcept {
+    return iterator(this, std::numeric_limits<size_t>::max());
+  }
+}; // class static_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_STATIC_BINARY_TREE_ARRAY_LIST_H
@@ -0,0 +1,288 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_STRING_BINARY_TREE_ARRAY_LIST_H
+#define IMDAST_STRING_BINARY_TREE_ARRAY_LIST_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace imdast {
+// A string key laid out for binary_tree_array_list slots: the first 8 bytes
+// are held inline as a big-endian integer, so most comparisons are a single
+// integer compare, and only the bytes past them are kept out of line. The key
+// does not own its tail, which must outlive it.
+class string_key {
+  static constexpr size_t inline_bytes = sizeof(uint64_t);
+
+  uint64_t _prefix;
+  const char *_tail;
+  size_t _size;
+
+  // Converts between the native and big-endian byte orders. On little-endian
+  // machines, compilers turn the shifts into a single byte swap.
+  static constexpr uint64_t big_endian(uint64_t value) noexcept {
+    if constexpr (std::endian::native == std::endian::little) {
+      value = value << 32 | value >> 32;
+      value = (value & 0x0000FFFF0000FFFF) << 16 |
+              (value >> 16 & 0x0000FFFF0000FFFF);
+      value = (value & 0x00FF00FF00FF00FF) << 8 |
+              (value >> 8 & 0x00FF00FF00FF00FF);
+    }
+    return value;
+  }
+
+public:
+  // Creates a key for str whose bytes past the prefix are read from tail.
+  string_key(std::string_view str, const char *tail) noexcept
+      : _prefix(0), _tail(tail), _size(str.size()) {
+    std::memcpy(&_prefix, str.data(), std::min(str.size(), inline_bytes));
+    _prefix = big_endian(_prefix);
+  }
+
+  // Creates a key that reads its tail straight out of str.
+  explicit string_key(std::string_view str) noexcept
+      : string_key(str, str.size() > inline_bytes ? str.data() + inline_bytes
+                                                  : nullptr) {}
+
+  // Returns a copy of the key that reads its tail from tail instead, which
+  // must hold the same bytes.
+  string_key relocated(const char *tail) const noexcept {
+    string_key key = *this;
+    key._tail = tail;
+    return key;
+  }
+
+  // Returns the number of bytes in the key.
+  size_t size() const noexcept { return _size; }
+
+  // Returns the bytes that are kept out of line.
+  std::string_view tail() const noexcept {
+    return _size > inline_bytes ? std::string_view(_tail, _size - inline_bytes)
+                                : std::string_view();
+  }
+
+  // Copies the key out into a std::string.
+  std::string str() const {
+    uint64_t prefix = big_endian(_prefix);
+    std::string str(reinterpret_cast<const char *>(&prefix),
+                    std::min(_size, inline_bytes));
+    str += tail();
+    return str;
+  }
+
+  // Orders keys as their bytes would be by std::string_view. Prefixes padded
+  // with zeros only tie when the keys agree on their first 8 bytes, or one is
+  // the other followed by zeros, so tails and sizes settle the rest.
+  std::strong_ordering operator<=>(const string_key &key) const noexcept {
+    if (_prefix != key._prefix)
+      return _prefix <=> key._prefix;
+    if (_size <= inline_bytes || key._size <= inline_bytes)
+      return _size <=> key._size;
+    return tail().compare(key.tail()) <=> 0;
+  }
+
+  bool operator==(const string_key &key) const noexcept {
+    return _prefix == key._prefix && _size == key._size &&
+           tail() == key.tail();
+  }
+}; // class string_key
+
+// A binary_tree_array_list of strings. Slots hold string_keys, so walking the
+// tree reads the inline prefixes without leaving the slot array and shift()
+// moves 24-byte keys rather than whole strings. The bytes past each prefix
+// are copied into an arena of large chunks owned by the list, which never
+// moves them; removed keys leave their bytes behind until enough have piled
+// up that compacting the arena is cheaper than keeping them.
+class string_binary_tree_array_list {
+  static constexpr size_t chunk_bytes = 64 * 1024;
+
+  binary_tree_array_list<string_key> _tree;
+  std::vector<std::unique_ptr<char[]>> _chunks;
+  // Free bytes at the end of the last chunk.
+  char *_free = nullptr;
+  size_t _free_bytes = 0;
+  // Arena bytes held by keys in the list, and by keys since removed.
+  size_t _live_bytes = 0;
+  size_t _dead_bytes = 0;
+
+  // Copies bytes into the arena and returns where they were put.
+  const char *store(std::string_view bytes) {
+    if (bytes.empty())
+      return nullptr;
+    if (bytes.size() > _free_bytes) {
+      size_t size = std::max(chunk_bytes, bytes.size());
+      _chunks.push_back(std::make_unique_for_overwrite<char[]>(size));
+      _free = _chunks.back().get();
+      _free_bytes = size;
+    }
+    char *stored = _free;
+    std::memcpy(stored, bytes.data(), bytes.size());
+    _free += bytes.size();
+    _free_bytes -= bytes.size();
+    _live_bytes += bytes.size();
+    return stored;
+  }
+
+  // Copies every live tail into a fresh arena and lays the tree out again,
+  // releasing the bytes of removed keys. The new arena and tree are built
+  // aside, so if allocating them throws, the list is left unchanged.
+  void compact() {
+    std::vector<string_key> keys = _tree.to_vector();
+    string_binary_tree_array_list compacted;
+    for (string_key &key : keys) {
+      key = key.relocated(compacted.store(key.tail()));
+    }
+    compacted._tree =
+        binary_tree_array_list<string_key>::from_sorted(std::move(keys));
+    *this = std::move(compacted);
+  }
+
+public:
+  using iterator = binary_tree_array_list<string_key>::iterator;
+
+  string_binary_tree_array_list() = default;
+
+  // Keys point into the arena, so a copy would share it; lists can only be
+  // moved, which keeps every chunk where it is.
+  string_binary_tree_array_list(const string_binary_tree_array_list &) =
+      delete;
+  string_binary_tree_array_list &
+  operator=(const string_binary_tree_array_list &) = delete;
+
+  // Takes over the keys and arena of another list, leaving that list empty.
+  string_binary_tree_array_list(string_binary_tree_array_list &&list) noexcept
+      : _tree(std::move(list._tree)), _chunks(std::move(list._chunks)),
+        _free(std::exchange(list._free, nullptr)),
+        _free_bytes(std::exchange(list._free_bytes, 0)),
+        _live_bytes(std::exchange(list._live_bytes, 0)),
+        _dead_bytes(std::exchange(list._dead_bytes, 0)) {
+    list.clear();
+  }
+
+  // Moves the right list's keys and arena into the left, leaving the right
+  // empty.
+  string_binary_tree_array_list &
+  operator=(string_binary_tree_array_list &&right) noexcept {
+    if (this != &right) {
+      _tree = std::move(right._tree);
+      _chunks = std::move(right._chunks);
+      _free = std::exchange(right._free, nullptr);
+      _free_bytes = std::exchange(right._free_bytes, 0);
+      _live_bytes = std::exchange(right._live_bytes, 0);
+      _dead_bytes = std::exchange(right._dead_bytes, 0);
+      right.clear();
+    }
+    return *this;
+  }
+
+  // Returns the number of strings in the list.
+  size_t size() const noexcept { return _tree.size(); }
+
+  // Returns if the list is empty.
+  bool empty() const noexcept { return _tree.empty(); }
+
+  // Returns the number of bytes held by the arena.
+  size_t arena_bytes() const noexcept {
+    return _live_bytes + _dead_bytes + _free_bytes;
+  }
+
+  // Returns the underlying list of keys.
+  const binary_tree_array_list<string_key> &tree() const noexcept {
+    return _tree;
+  }
+
+  // Removes all strings from the list and releases the arena.
+  void clear() noexcept {
+    _tree.clear();
+    _chunks.clear();
+    _free = nullptr;
+    _free_bytes = 0;
+    _live_bytes = 0;
+    _dead_bytes = 0;
+  }
+
+  // Inserts a copy of a string into the list in-order.
+  void insert(std::string_view str) {
+    string_key probe(str);
+    const char *tail = store(probe.tail());
+    try {
+      _tree.insert(string_key(str, tail));
+    } catch (...) {
+      _live_bytes -= probe.tail().size();
+      _dead_bytes += probe.tail().size();
+      throw;
+    }
+  }
+
+  // Removes a string from the list, returning whether it was in the list.
+  bool remove(std::string_view str) {
+    string_key probe(str);
+    if (!_tree.remove(probe))
+      return false;
+    _live_bytes -= probe.tail().size();
+    _dead_bytes += probe.tail().size();
+    // Compacting only gives memory back, so if it fails the removal still
+    // stands, and a later one tries again.
+    if (_dead_bytes > chunk_bytes && _dead_bytes > _live_bytes) {
+      try {
+        compact();
+      } catch (const std::bad_alloc &) {
+      }
+    }
+    return true;
+  }
+
+  // Checks if the list contains a string. Does not copy it.
+  bool contains(std::string_view str) const noexcept {
+    return _tree.contains(string_key(str));
+  }
+
+  // Creates an iterator pointing to the smallest string in the list.
+  iterator begin() const noexcept { return _tree.begin(); }
+
+  // Creates an iterator pointing to the past-the-last string.
+  iterator end() const noexcept { return _tree.end(); }
+
+  // Copies the strings out in order.
+  std::vector<std::string> to_vector() const {
+    std::vector<std::string> strings;
+    strings.reserve(size());
+    for (const string_key &key : _tree) {
+      strings.push_back(key.str());
+    }
+    return strings;
+  }
+}; // class string_binary_tree_array_list
+} // namespace imdast
+
+#endif // IMDAST_STRING_BINARY_TREE_ARRAY_LIST_H
@@ -0,0 +1,203 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_TRACE_H
+#define IMDAST_TRACE_H
+
+#include "binary_tree_array_list.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace imdast {
+// A trace file starts with this header and continues with one record per
+// operation: the trace_op as one byte, followed by the item's bytes for
+// INSERT, REMOVE, CONTAINS and FIND, by the rank as a uint64_t for AT and
+// ITERATE, or by the number of steps as a uint64_t for STEP.
+struct trace_header {
+  char magic[8];
+  uint32_t item_size;
+  uint32_t reserved;
+};
+
+inline constexpr char trace_magic[8] = {'I', 'M', 'D', 'T',
+                                        'R', 'A', 'C', 'E'};
+
+// Returns whether op carries an item rather than a rank or a count.
+constexpr bool trace_op_has_value(trace_op op) {
+  return op != trace_op::AT && op != trace_op::ITERATE &&
+         op != trace_op::STEP;
+}
+
+// One operation read back from a trace.
+template <class T> struct trace_entry {
+  trace_op op;
+  // The item, for operations that carry one.
+  T value;
+  // The rank, for AT and ITERATE, or the number of steps, for STEP.
+  uint64_t index;
+};
+
+// A trace_sink that appends the operations of the lists attached to it to a
+// trace file. Lists only report operations when IMDAST_BTAL_TRACE is defined.
+// Const operations such as contains() report too, so threads reading the same
+// list may record at once; each record is written whole under a lock.
+template <class T> class trace_recorder : public trace_sink<T> {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Traced items must be trivially copyable");
+
+  std::unique_ptr<FILE, int (*)(FILE *)> _file;
+  mutable std::mutex _mutex;
+  uint64_t _records;
+  bool _good;
+
+public:
+  // Creates or truncates the trace file at path. Throws a std::system_error
+  // if it cannot be written.
+  explicit trace_recorder(const std::string &path)
+      : _file(std::fopen(path.c_str(), "wb"), &std::fclose), _records(0),
+        _good(true) {
+    if (!_file)
+      throw std::system_error(errno, std::generic_category(),
+                              "Could not create trace");
+    trace_header header;
+    std::memcpy(header.magic, trace_magic, sizeof(header.magic));
+    header.item_size = sizeof(T);
+    header.reserved = 0;
+    if (std::fwrite(&header, sizeof(header), 1, _file.get()) != 1)
+      throw std::system_error(errno, std::generic_category(),
+                              "Could not write trace");
+  }
+
+  // Returns the number of operations recorded so far.
+  uint64_t records() const {
+    std::lock_guard lock(_mutex);
+    return _records;
+  }
+
+  // Returns whether every operation so far has been handed to the file in
+  // full. Records are buffered, so a failed write may only show up here after
+  // flush(). Once a write fails, later operations are not recorded, and the
+  // file may end partway through one.
+  bool good() const {
+    std::lock_guard lock(_mutex);
+    return _good;
+  }
+
+  // Writes any buffered records to the file.
+  void flush() {
+    std::lock_guard lock(_mutex);
+    if (std::fflush(_file.get()) != 0)
+      _good = false;
+  }
+
+  void record(trace_op op, const T *value, size_t index) noexcept override {
+    unsigned char bytes[1 + std::max(sizeof(T), sizeof(uint64_t))];
+    size_t length = 1;
+    bytes[0] = static_cast<unsigned char>(op);
+    if (trace_op_has_value(op)) {
+      std::memcpy(bytes + 1, value, sizeof(T));
+      length += sizeof(T);
+    } else {
+      uint64_t rank = index;
+      std::memcpy(bytes + 1, &rank, sizeof(rank));
+      length += sizeof(rank);
+    }
+
+    std::lock_guard lock(_mutex);
+    if (!_good)
+      return;
+    if (std::fwrite(bytes, 1, length, _file.get()) != length) {
+      _good = false;
+      return;
+    }
+    _records++;
+  }
+}; // class trace_recorder
+
+// Reads the operations of a trace file back in order.
+template <class T> class trace_reader {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Traced items must be trivially copyable");
+
+  std::unique_ptr<FILE, int (*)(FILE *)> _file;
+
+public:
+  // Opens the trace file at path. Throws a std::system_error if it cannot be
+  // read, and a std::logic_error if it is not a trace of items of type T.
+  explicit trace_reader(const std::string &path)
+      : _file(std::fopen(path.c_str(), "rb"), &std::fclose) {
+    if (!_file)
+      throw std::system_error(errno, std::generic_category(),
+                              "Could not open trace");
+    trace_header header;
+    if (std::fread(&header, sizeof(header), 1, _file.get()) != 1 ||
+        std::memcmp(header.magic, trace_magic, sizeof(header.magic)) ||
+        header.item_size != sizeof(T))
+      throw std::logic_error("Not a trace of items of this type");
+  }
+
+  // Returns the item size recorded in the trace file at path, or 0 if it is
+  // not a trace.
+  static uint32_t item_size(const std::string &path) {
+    std::unique_ptr<FILE, int (*)(FILE *)> file(
+        std::fopen(path.c_str(), "rb"), &std::fclose);
+    trace_header header;
+    if (!file || std::fread(&header, sizeof(header), 1, file.get()) != 1 ||
+        std::memcmp(header.magic, trace_magic, sizeof(header.magic)))
+      return 0;
+    return header.item_size;
+  }
+
+  // Reads the next operation into entry, returning false at the end of the
+  // trace. Throws a std::logic_error if the trace is truncated or corrupt.
+  bool next(trace_entry<T> &entry) {
+    int op = std::fgetc(_file.get());
+    if (op == EOF)
+      return false;
+    if (op > static_cast<int>(trace_op::STEP))
+      throw std::logic_error("Unknown operation in trace");
+    entry.op = static_cast<trace_op>(op);
+    bool complete;
+    if (trace_op_has_value(entry.op)) {
+      complete = std::fread(&entry.value, sizeof(T), 1, _file.get()) == 1;
+      entry.index = 0;
+    } else {
+      complete = std::fread(&entry.index, sizeof(entry.index), 1,
+                            _file.get()) == 1;
+    }
+    if (!complete)
+      throw std::logic_error("Trace ends partway through an operation");
+    return true;
+  }
+}; // class trace_reader
+} // namespace imdast
+
+#endif // IMDAST_TRACE_H
@@ -0,0 +1,127 @@
+/* Copyright 2025 Michael Mark
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMDAST_VEB_VIEW_H
+#define IMDAST_VEB_VIEW_H
+
+#include "binary_tree_array_list.h"
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace imdast {
+// A read-only copy of a binary_tree_array_list that stores the same tree in
+// van Emde Boas order instead of level order. A tree of height h is split into
+// a top tree of height h / 2 followed by the bottom trees hanging below it,
+// each laid out the same way recursively, so every search touches
+// O(log_B n) cache lines and pages for any block size B.
+//
+// Positions are found with per-depth tables rather than the LEFT and RIGHT
+// macros: a node at depth d is the root of a bottom tree of size bottom[d]
+// that hangs below a top tree of size top[d] rooted at depth root[d]. Its
+// position is that top tree's position plus top[d], plus bottom[d] for every
+// bottom tree to its left, which the low bits of its level-order index give
+// directly.
+template <class T> class veb_view {
+  std::vector<std::optional<T>> _data;
+  std::vector<size_t> _top;
+  std::vector<size_t> _bottom;
+  std::vector<size_t> _root;
+  size_t _size;
+  size_t _height;
+
+  // Fills the tables for the subtree of the given height rooted at depth.
+  void fill_tables(size_t depth, size_t height) {
+    if (height <= 1)
+      return;
+    size_t top = height / 2;
+    size_t bottom = height - top;
+    _top[depth + top] = (size_t(1) << top) - 1;
+    _bottom[depth + top] = (size_t(1) << bottom) - 1;
+    _root[depth + top] = depth;
+    fill_tables(depth, top);
+    fill_tables(depth + top, bottom);
+  }
+
+  // Returns the position of the node at the given depth whose 1-based
+  // level-order index is node, given the positions of its ancestors.
+  size_t position(size_t depth, size_t node, const size_t *path) const {
+    return path[_root[depth]] + _top[depth] +
+           (node & _top[depth]) * _bottom[depth];
+  }
+
+  // Copies the subtree rooted at index in list into its van Emde Boas
+  // position. path holds the positions of the ancestors of index.
+  void copy_subtree(const binary_tree_array_list<T> &list, size_t index,
+                    size_t depth, size_t *path) {
+    if (index >= list._capacity || !list._data[index].has_value())
+      return;
+    path[depth] = depth == 0 ? 0 : position(depth, index + 1, path);
+    _data[path[depth]] = list._data[index];
+    copy_subtree(list, LEFT(index), depth + 1, path);
+    copy_subtree(list, RIGHT(index), depth + 1, path);
+  }
+
+public:
+  // Creates an empty view.
+  veb_view() noexcept : _size(0), _height(0) {}
+
+  // Copies the tree of list into van Emde Boas order. Runs in O(n + 2^h),
+  // where h is the height of the tree. Later changes to list are not
+  // reflected.
+  explicit veb_view(const binary_tree_array_list<T> &list)
+      : _size(list._size), _height(list._capacity ? list._height[0] : 0) {
+    _data.resize((size_t(1) << _height) - 1);
+    _top.resize(_height);
+    _bottom.resize(_height);
+    _root.resize(_height);
+    fill_tables(0, _height);
+    std::vector<size_t> path(_height);
+    copy_subtree(list, 0, 0, path.data());
+  }
+
+  // Returns the number of items in the view.
+  size_t size() const noexcept { return _size; }
+
+  // Returns if the view is empty.
+  bool empty() const noexcept { return !_size; }
+
+  // Checks if the view contains an item.
+  bool contains(const T &value) const noexcept {
+    size_t path[64];
+    size_t node = 1;
+    path[0] = 0;
+    for (size_t depth = 0; depth < _height; depth++) {
+      if (depth > 0)
+        path[depth] = position(depth, node, path);
+      const std::optional<T> &slot = _data[path[depth]];
+      if (!slot.has_value())
+        return false;
+      if (value == slot.value())
+        return true;
+      node = node * 2 + !(value < slot.value());
+    }
+    return false;
+  }
+}; // class veb_view
+} // namespace imdast
+
+#endif // IMDAST_VEB_VIEW_H
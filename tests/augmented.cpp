@@ -0,0 +1,135 @@
+#include "../src/binary_tree_array_list.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+
+using namespace imdast;
+
+namespace {
+// Tracks the first and last item of a range, so that it only gives the right
+// answer if summaries are combined in order.
+struct ends_augmentation {
+  struct value_type {
+    bool empty;
+    int first;
+    int last;
+    int count;
+  };
+  static value_type identity() { return {true, 0, 0, 0}; }
+  static value_type lift(int item) { return {false, item, item, 1}; }
+  static value_type combine(const value_type &left, const value_type &right) {
+    if (left.empty)
+      return right;
+    if (right.empty)
+      return left;
+    return {false, left.first, right.last, left.count + right.count};
+  }
+};
+
+// Checks every range query of list against reference, over [lo, hi) windows
+// of several sizes.
+template <class List, class Reference>
+void expect_sums(const List &list, const Reference &reference) {
+  long long total = 0;
+  for (int item : reference) {
+    total += item;
+  }
+  EXPECT_EQ(list.aggregate(), total);
+  for (int lo = -10; lo < 1'010; lo += 37) {
+    for (int width : {0, 1, 5, 50, 400, 2'000}) {
+      long long expected = 0;
+      for (auto it = reference.lower_bound(lo);
+           it != reference.end() && *it < lo + width; ++it) {
+        expected += *it;
+      }
+      ASSERT_EQ(list.aggregate(lo, lo + width), expected)
+          << "[" << lo << ", " << lo + width << ")";
+    }
+  }
+}
+} // namespace
+
+TEST(btal_augmented_suite, sum_test) {
+  binary_tree_array_list<int, sum_augmentation<long long>> list;
+  EXPECT_EQ(list.aggregate(), 0);
+  EXPECT_EQ(list.aggregate(0, 100), 0);
+
+  std::multiset<int> reference;
+  std::mt19937 rng(4321);
+  for (int i = 0; i < 4'000; i++) {
+    int value = rng() % 1'000;
+    if (rng() % 3 == 0) {
+      auto it = reference.find(value);
+      ASSERT_EQ(list.remove(value), it != reference.end());
+      if (it != reference.end())
+        reference.erase(it);
+    } else {
+      list.insert(value);
+      reference.insert(value);
+    }
+    if (i % 500 == 0)
+      expect_sums(list, reference);
+  }
+  expect_sums(list, reference);
+
+  // Summaries survive relayouts, copies and splits.
+  auto copy = list;
+  copy.insert(5);
+  reference.insert(5);
+  expect_sums(copy, reference);
+  list.optimize();
+  reference.erase(reference.find(5));
+  expect_sums(list, reference);
+
+  auto upper = list.split_off(500);
+  std::multiset<int> lower(reference.begin(), reference.lower_bound(500));
+  std::multiset<int> higher(reference.lower_bound(500), reference.end());
+  expect_sums(list, lower);
+  expect_sums(upper, higher);
+  auto joined = decltype(list)::join(std::move(list), std::move(upper));
+  expect_sums(joined, reference);
+}
+
+TEST(btal_augmented_suite, min_max_test) {
+  binary_tree_array_list<int, max_augmentation<int>> maxima;
+  binary_tree_array_list<int, min_augmentation<int>> minima;
+  for (int i = 0; i < 1'000; i++) {
+    int value = (i * 7'919) % 1'000;
+    maxima.insert(value);
+    minima.insert(value);
+  }
+  EXPECT_EQ(maxima.aggregate(), 999);
+  EXPECT_EQ(minima.aggregate(), 0);
+  EXPECT_EQ(maxima.aggregate(100, 200), 199);
+  EXPECT_EQ(minima.aggregate(100, 200), 100);
+  EXPECT_EQ(maxima.aggregate(5'000, 6'000),
+            std::numeric_limits<int>::lowest());
+
+  maxima.remove(199);
+  minima.remove(100);
+  EXPECT_EQ(maxima.aggregate(100, 200), 198);
+  EXPECT_EQ(minima.aggregate(100, 200), 101);
+}
+
+TEST(btal_augmented_suite, order_test) {
+  auto list = binary_tree_array_list<int, ends_augmentation>::from_sorted(
+      {1, 2, 3, 5, 8, 13, 21, 34, 55});
+  auto all = list.aggregate();
+  EXPECT_EQ(all.first, 1);
+  EXPECT_EQ(all.last, 55);
+  EXPECT_EQ(all.count, 9);
+
+  auto range = list.aggregate(4, 34);
+  EXPECT_EQ(range.first, 5);
+  EXPECT_EQ(range.last, 21);
+  EXPECT_EQ(range.count, 4);
+
+  for (int i = 100; i > 55; i--) {
+    list.insert(i);
+  }
+  range = list.aggregate(50, 60);
+  EXPECT_EQ(range.first, 55);
+  EXPECT_EQ(range.last, 59);
+  EXPECT_EQ(range.count, 5);
+  EXPECT_TRUE(list.aggregate(40, 50).empty);
+}
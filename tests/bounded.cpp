@@ -0,0 +1,90 @@
+#include "../src/bounded_binary_tree_array_list.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace imdast;
+
+TEST(btal_bounded_suite, insert_contains_test) {
+  auto list = bounded_binary_tree_array_list<int>(8);
+
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(list.contains(5));
+  for (int i = 0; i < 10'000; i++) {
+    list.insert(i * 2);
+    ASSERT_TRUE(list.contains(i * 2));
+  }
+  EXPECT_EQ(list.size(), 10'000);
+  // The buffer grows with the list.
+  EXPECT_GE(list.buffer_capacity(), 64);
+  for (int i = 0; i < 10'000; i++) {
+    ASSERT_TRUE(list.contains(i * 2));
+    ASSERT_FALSE(list.contains(i * 2 + 1));
+  }
+
+  list.flush();
+  EXPECT_EQ(list.buffered(), 0);
+  EXPECT_FALSE(list.merging());
+  EXPECT_EQ(list.size(), 10'000);
+  auto items = list.to_vector();
+  for (int i = 0; i < 10'000; i++) {
+    ASSERT_EQ(items[i], i * 2);
+  }
+
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(list.contains(0));
+
+  EXPECT_THROW(bounded_binary_tree_array_list<int>(1), std::logic_error);
+}
+
+TEST(btal_bounded_suite, random_test) {
+  auto list = bounded_binary_tree_array_list<int>(4);
+  auto expected = std::multiset<int>();
+  auto rng = std::mt19937(5);
+  auto value = std::uniform_int_distribution<int>(0, 300);
+
+  for (int i = 0; i < 30'000; i++) {
+    int item = value(rng);
+    if (rng() % 3) {
+      list.insert(item);
+      expected.insert(item);
+    } else {
+      auto found = expected.find(item);
+      ASSERT_EQ(list.remove(item), found != expected.end());
+      if (found != expected.end())
+        expected.erase(found);
+    }
+    ASSERT_EQ(list.size(), expected.size());
+    // Reads see every write, whether it is buffered, being merged or merged.
+    int probe = value(rng);
+    ASSERT_EQ(list.contains(probe), expected.contains(probe));
+    if (i % 1'000 == 0) {
+      ASSERT_EQ(list.to_vector(),
+                std::vector<int>(expected.begin(), expected.end()));
+    }
+  }
+  list.flush();
+  EXPECT_EQ(list.to_vector(),
+            std::vector<int>(expected.begin(), expected.end()));
+}
+
+TEST(btal_bounded_suite, merge_schedule_test) {
+  auto list = bounded_binary_tree_array_list<long>(16);
+  auto rng = std::mt19937_64(9);
+  size_t merges = 0;
+
+  for (int i = 0; i < 100'000; i++) {
+    // A merge always ends before the write that fills the buffer again, so
+    // no write has to finish one at once.
+    if (list.buffered() + 1 == list.buffer_capacity()) {
+      ASSERT_FALSE(list.merging());
+      merges++;
+    }
+    list.insert(static_cast<long>(rng() >> 1));
+  }
+  EXPECT_GT(merges, 100);
+  EXPECT_EQ(list.size(), 100'000);
+}
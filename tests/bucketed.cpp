@@ -0,0 +1,197 @@
+#include "../src/bucketed_binary_tree_array_list.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+using namespace imdast;
+
+TEST(btal_bucketed_suite, insert_contains_test) {
+  auto list = bucketed_binary_tree_array_list<int, 8>();
+
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(list.contains(5));
+  for (int i = 0; i < 1'000; i++) {
+    list.insert(i * 2);
+  }
+  EXPECT_EQ(list.size(), 1'000);
+  for (int i = 0; i < 1'000; i++) {
+    ASSERT_TRUE(list.contains(i * 2));
+    ASSERT_FALSE(list.contains(i * 2 + 1));
+  }
+  EXPECT_FALSE(list.contains(-1));
+
+  // Buckets split in half when full, so they are at least half full.
+  EXPECT_LE(list.bucket_count(), 1'000 / 4 + 1);
+  EXPECT_LT(list.stats().height, 10);
+}
+
+TEST(btal_bucketed_suite, iteration_test) {
+  auto list = bucketed_binary_tree_array_list<int, 4>();
+
+  EXPECT_EQ(list.begin(), list.end());
+  int values[] = {40, -5, 25, 80, 25, 3, 17, 99, -20};
+  for (int value : values) {
+    list.insert(value);
+  }
+  std::multiset<int> expected(std::begin(values), std::end(values));
+  auto reference = expected.begin();
+  for (int item : list) {
+    EXPECT_EQ(item, *reference++);
+  }
+  EXPECT_EQ(reference, expected.end());
+
+  auto iter = list.end();
+  EXPECT_EQ(iter.get(), std::nullopt);
+  EXPECT_THROW(*iter, std::logic_error);
+  EXPECT_FALSE(iter.next());
+}
+
+TEST(btal_bucketed_suite, remove_test) {
+  auto list = bucketed_binary_tree_array_list<int, 8>();
+
+  EXPECT_FALSE(list.remove(5));
+  for (int i = 0; i < 200; i++) {
+    list.insert(i);
+  }
+  for (int i = 0; i < 200; i += 2) {
+    ASSERT_TRUE(list.remove(i));
+  }
+  EXPECT_FALSE(list.remove(0));
+  EXPECT_EQ(list.size(), 100);
+  int expected = 1;
+  for (int item : list) {
+    ASSERT_EQ(item, expected);
+    expected += 2;
+  }
+
+  for (int i = 1; i < 200; i += 2) {
+    ASSERT_TRUE(list.remove(i));
+  }
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.bucket_count(), 0);
+  EXPECT_EQ(list.begin(), list.end());
+
+  list.insert(3);
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(list.contains(3));
+}
+
+TEST(btal_bucketed_suite, random_test) {
+  auto list = bucketed_binary_tree_array_list<int, 16>();
+  std::multiset<int> reference;
+  std::mt19937 rng(6789);
+
+  for (int i = 0; i < 20'000; i++) {
+    int value = rng() % 2'000;
+    if (rng() % 3) {
+      list.insert(value);
+      reference.insert(value);
+    } else {
+      bool present = reference.count(value) > 0;
+      ASSERT_EQ(list.remove(value), present);
+      if (present)
+        reference.erase(reference.find(value));
+    }
+  }
+
+  ASSERT_EQ(list.size(), reference.size());
+  auto expected = reference.begin();
+  for (int item : list) {
+    ASSERT_EQ(item, *expected++);
+  }
+  for (int value = 0; value < 2'000; value++) {
+    ASSERT_EQ(list.contains(value), reference.count(value) > 0);
+  }
+}
+
+TEST(btal_bucketed_suite, copy_test) {
+  auto list = bucketed_binary_tree_array_list<int, 8>();
+  for (int i = 0; i < 100; i++) {
+    list.insert(i);
+  }
+
+  auto copy = list;
+  list.insert(1'000);
+  list.remove(0);
+  copy.remove(50);
+
+  EXPECT_EQ(list.size(), 100);
+  EXPECT_FALSE(list.contains(0));
+  EXPECT_TRUE(list.contains(50));
+  EXPECT_EQ(copy.size(), 99);
+  EXPECT_TRUE(copy.contains(0));
+  EXPECT_FALSE(copy.contains(50));
+  EXPECT_FALSE(copy.contains(1'000));
+}
+
+namespace {
+// Copies throw once a shared budget runs out.
+struct fragile {
+  static inline int copies_left = -1;
+  int value;
+
+  fragile() : value(0) {}
+  fragile(int value) : value(value) {}
+  fragile(const fragile &other) : value(other.value) {
+    if (copies_left == 0)
+      throw std::runtime_error("copy failed");
+    if (copies_left > 0)
+      copies_left--;
+  }
+  fragile &operator=(const fragile &) = default;
+
+  bool operator==(const fragile &other) const { return value == other.value; }
+  bool operator<(const fragile &other) const { return value < other.value; }
+};
+} // namespace
+
+TEST(btal_bucketed_suite, insert_exception_safety_test) {
+  auto list = bucketed_binary_tree_array_list<fragile, 4>();
+
+  // The first item starts a bucket, and copying it into the tree fails.
+  fragile::copies_left = 0;
+  EXPECT_THROW(list.insert(fragile(1)), std::runtime_error);
+  fragile::copies_left = -1;
+  EXPECT_EQ(list.size(), 0);
+  EXPECT_TRUE(list.empty());
+
+  list.insert(fragile(1));
+  EXPECT_EQ(list.size(), 1);
+  EXPECT_TRUE(list.contains(fragile(1)));
+}
+
+TEST(btal_bucketed_suite, split_exception_safety_test) {
+  // Whichever copy fails while a full bucket splits, the bucket is restored.
+  for (int value : {5, 25}) {
+    for (int budget = 0; budget < 20; budget++) {
+      auto list = bucketed_binary_tree_array_list<fragile, 4>();
+      for (int i = 0; i < 4; i++) {
+        list.insert(fragile(i * 10));
+      }
+
+      fragile::copies_left = budget;
+      bool inserted = true;
+      try {
+        list.insert(fragile(value));
+      } catch (const std::runtime_error &) {
+        inserted = false;
+      }
+      fragile::copies_left = -1;
+
+      std::multiset<int> expected = {0, 10, 20, 30};
+      if (inserted)
+        expected.insert(value);
+      ASSERT_EQ(list.size(), expected.size());
+      auto reference = expected.begin();
+      for (fragile item : list) {
+        ASSERT_EQ(item.value, *reference++);
+      }
+      ASSERT_EQ(reference, expected.end());
+      for (int item : expected) {
+        ASSERT_TRUE(list.contains(fragile(item)));
+      }
+    }
+  }
+}
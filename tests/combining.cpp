@@ -0,0 +1,100 @@
+#include "../src/combining_binary_tree_array_list.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace imdast;
+
+TEST(btal_combining_suite, single_thread_test) {
+  auto list = combining_binary_tree_array_list<int>(4);
+
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(list.contains(5));
+  for (int i = 0; i < 1'000; i++) {
+    list.insert(i * 2);
+  }
+  EXPECT_EQ(list.size(), 1'000);
+  EXPECT_TRUE(list.contains(10));
+  EXPECT_FALSE(list.contains(11));
+  EXPECT_TRUE(list.remove(10));
+  EXPECT_FALSE(list.remove(10));
+  EXPECT_EQ(list.size(), 999);
+
+  // Alone, every operation is a batch of its own.
+  EXPECT_EQ(list.batches(), 1'005);
+  EXPECT_TRUE(list.read([](const auto &inner) {
+    return std::is_sorted(inner.begin(), inner.end());
+  }));
+}
+
+TEST(btal_combining_suite, concurrent_test) {
+  constexpr int threads = 8;
+  constexpr int per_thread = 2'000;
+  auto list = combining_binary_tree_array_list<int>(threads / 2);
+  std::atomic<int> removed = 0;
+  std::atomic<bool> lost = false;
+
+  std::vector<std::jthread> writers;
+  for (int t = 0; t < threads; t++) {
+    writers.emplace_back([&list, &removed, &lost, t] {
+      for (int i = 0; i < per_thread; i++) {
+        int value = i * threads + t;
+        list.insert(value);
+        if (!list.contains(value))
+          lost = true;
+        if (i % 4 == 0 && list.remove(value))
+          removed++;
+      }
+    });
+  }
+  writers.clear();
+
+  EXPECT_FALSE(lost);
+  EXPECT_EQ(removed, threads * per_thread / 4);
+  EXPECT_EQ(list.size(), threads * per_thread - removed);
+  list.read([&](const auto &inner) {
+    EXPECT_EQ(inner.size(), list.size());
+    int previous = -1;
+    for (int item : inner) {
+      EXPECT_LT(previous, item);
+      EXPECT_NE((item / threads) % 4, 0);
+      previous = item;
+    }
+    return 0;
+  });
+}
+
+namespace {
+// Copies throw while throwing is set.
+struct fragile {
+  static inline bool throwing = false;
+  int value;
+
+  fragile(int value) : value(value) {}
+  fragile(const fragile &other) : value(other.value) {
+    if (throwing)
+      throw std::runtime_error("copy failed");
+  }
+  fragile &operator=(const fragile &) = default;
+
+  bool operator==(const fragile &other) const { return value == other.value; }
+  bool operator<(const fragile &other) const { return value < other.value; }
+};
+} // namespace
+
+TEST(btal_combining_suite, publish_exception_safety_test) {
+  auto list = combining_binary_tree_array_list<fragile>(2);
+
+  // A slot whose value cannot be copied in is given back.
+  fragile::throwing = true;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_THROW(list.insert(fragile(i)), std::runtime_error);
+  }
+  fragile::throwing = false;
+
+  list.insert(fragile(7));
+  EXPECT_EQ(list.size(), 1);
+  EXPECT_TRUE(list.contains(fragile(7)));
+}
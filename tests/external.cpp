@@ -0,0 +1,116 @@
+#include "../src/external_builder.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace imdast;
+
+static std::string temporary_path(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(btal_external_suite, build_test) {
+  std::string directory = std::filesystem::temp_directory_path().string();
+  std::string path = temporary_path("imdast-build-test.snapshot");
+  std::mt19937 rng(44);
+  std::uniform_int_distribution<int> dist(-5'000, 5'000);
+
+  for (size_t count : {0, 1, 2, 7, 100, 10'000}) {
+    // Runs of 64 items merged two at a time force several merge passes.
+    auto builder = external_builder<int>(directory, 64 * sizeof(int), 2);
+    std::vector<int> items;
+    for (size_t i = 0; i < count; i++) {
+      items.push_back(dist(rng));
+      builder.add(items.back());
+    }
+    EXPECT_EQ(builder.size(), count);
+    builder.build(path);
+    EXPECT_EQ(builder.size(), 0);
+
+    std::sort(items.begin(), items.end());
+    auto expected = binary_tree_array_list<int>::from_sorted(items);
+    auto snapshot = mapped_snapshot<int>(path);
+    ASSERT_EQ(snapshot.size(), count);
+    for (int probe = -5'010; probe <= 5'010; probe += 7) {
+      ASSERT_EQ(snapshot.contains(probe), expected.contains(probe));
+    }
+
+    // The snapshot holds the layout from_sorted() builds.
+    auto list = snapshot.to_list();
+    EXPECT_EQ(list.capacity(), expected.capacity());
+    EXPECT_EQ(list.to_vector(), items);
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(list[i], expected[i]);
+    }
+    if (count) {
+      EXPECT_EQ(list.min(), items.front());
+      list.insert(0);
+      list.remove(items.back());
+      EXPECT_EQ(list.size(), count);
+    }
+  }
+  std::remove(path.c_str());
+}
+
+TEST(btal_external_suite, open_runs_test) {
+  std::string path = temporary_path("imdast-open-runs-test.snapshot");
+  // 2'000 runs of 16 items, far more than fan_in files, are never all open.
+  auto builder = external_builder<int>(
+      std::filesystem::temp_directory_path().string(), 16 * sizeof(int), 4);
+  std::vector<int> items;
+  for (int i = 0; i < 32'000; i++) {
+    items.push_back((i * 7'919) % 32'000);
+    builder.add(items.back());
+    ASSERT_LT(builder.runs(), 4);
+  }
+  builder.build(path);
+
+  std::sort(items.begin(), items.end());
+  EXPECT_EQ(mapped_snapshot<int>(path).to_list().to_vector(), items);
+  std::remove(path.c_str());
+}
+
+TEST(btal_external_suite, records_test) {
+  std::string records = temporary_path("imdast-records-test.bin");
+  std::string path = temporary_path("imdast-records-test.snapshot");
+  std::vector<double> items;
+  for (int i = 0; i < 5'000; i++) {
+    items.push_back((i * 7'919) % 5'000 * 0.5);
+  }
+  FILE *file = std::fopen(records.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  std::fwrite(items.data(), sizeof(double), items.size(), file);
+  std::fclose(file);
+
+  auto builder = external_builder<double>(
+      std::filesystem::temp_directory_path().string(), 1'000 * sizeof(double));
+  builder.add_records(records);
+  EXPECT_EQ(builder.size(), 5'000);
+  EXPECT_EQ(builder.runs(), 4);
+  builder.build(path);
+
+  auto snapshot = mapped_snapshot<double>(path);
+  EXPECT_TRUE(snapshot.contains(1'249.5));
+  EXPECT_FALSE(snapshot.contains(1'249.25));
+  std::sort(items.begin(), items.end());
+  EXPECT_EQ(snapshot.to_list().to_vector(), items);
+
+  // A snapshot of doubles is not a snapshot of ints, and a trailing partial
+  // record is an error.
+  EXPECT_THROW(mapped_snapshot<int>{path}, std::logic_error);
+  file = std::fopen(records.c_str(), "ab");
+  std::fputc(0, file);
+  std::fclose(file);
+  EXPECT_THROW(builder.add_records(records), std::logic_error);
+  EXPECT_THROW(builder.add_records(temporary_path("imdast-missing.bin")),
+               std::system_error);
+  EXPECT_THROW(external_builder<double>("/tmp", 4), std::logic_error);
+
+  std::remove(records.c_str());
+  std::remove(path.c_str());
+}
@@ -1,7 +1,16 @@
 #include "../src/binary_tree_array_list.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <optional>
+#include <random>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace imdast;
 
@@ -491,3 +500,746 @@ TEST(btal_functions_suite, mass_remove_test) {
   }
   EXPECT_EQ(list.size(), 5'000);
 }
+
+TEST(btal_functions_suite, stats_test) {
+  auto list = binary_tree_array_list<int>();
+
+  auto empty = list.stats();
+  EXPECT_EQ(empty.size, 0);
+  EXPECT_EQ(empty.capacity, 0);
+  EXPECT_EQ(empty.height, 0);
+  EXPECT_TRUE(empty.level_fill.empty());
+  EXPECT_EQ(empty.bytes_allocated, 0);
+
+  for (int i = 0; i < 7; i++) {
+    list.insert(i);
+  }
+  auto full = list.stats();
+  EXPECT_EQ(full.size, 7);
+  EXPECT_EQ(full.height, 3);
+  ASSERT_GE(full.level_fill.size(), 3);
+  EXPECT_EQ(full.level_fill[0], 1.0);
+  EXPECT_EQ(full.level_fill[1], 1.0);
+  EXPECT_EQ(full.level_fill[2], 1.0);
+  EXPECT_EQ(full.bytes_allocated,
+            full.capacity * (sizeof(std::optional<int>) + sizeof(uint8_t)));
+  EXPECT_EQ(full.bytes_unused,
+            (full.capacity - 7) * (sizeof(std::optional<int>) + 1));
+  // Sequential inserts grow a fourth layer that rebalancing empties again.
+  EXPECT_EQ(full.level_fill.size(), 4);
+  EXPECT_EQ(full.level_fill[3], 0.0);
+  EXPECT_EQ(full.bytes_unused_levels,
+            8 * (sizeof(std::optional<int>) + sizeof(uint8_t)));
+}
+
+#ifdef IMDAST_BTAL_INSTRUMENT
+TEST(btal_functions_suite, counters_test) {
+  auto list = binary_tree_array_list<int>();
+
+  list.insert(0);
+  list.insert(1);
+  list.insert(2);
+  EXPECT_EQ(list.counters().inserts, 3);
+  EXPECT_EQ(list.counters().rebalances[3], 1);
+  EXPECT_GT(list.counters().comparisons, 0);
+  EXPECT_GT(list.counters().shifted_slots, 0);
+  EXPECT_EQ(list.counters().reallocations, 3);
+  EXPECT_GT(list.counters().bytes_allocated, 0);
+
+  list.reset_counters();
+  EXPECT_TRUE(list.contains(2));
+  EXPECT_EQ(list.counters().comparisons, 3);
+  EXPECT_TRUE(list.remove(1));
+  EXPECT_EQ(list.counters().removes, 1);
+  EXPECT_EQ(list.counters().inserts, 0);
+}
+
+TEST(btal_functions_suite, counters_concurrent_readers_test) {
+  auto list = binary_tree_array_list<int>();
+  list.insert(0);
+  list.insert(1);
+  list.insert(2);
+  list.reset_counters();
+
+  // Each contains(2) compares twice against 1 and once against 2.
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&list] {
+      for (int i = 0; i < 10'000; i++) {
+        list.contains(2);
+      }
+    });
+  }
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(list.counters().comparisons, 4 * 10'000 * 3);
+}
+#endif
+
+TEST(btal_functions_suite, move_test) {
+  auto list = binary_tree_array_list<int>();
+  list.insert(21);
+  list.insert(8);
+  size_t capacity = list.capacity();
+
+  binary_tree_array_list<int> list2(std::move(list));
+  EXPECT_EQ(list2.size(), 2);
+  EXPECT_EQ(list2.capacity(), capacity);
+  EXPECT_EQ(list2[0], 8);
+  EXPECT_EQ(list2[1], 21);
+  EXPECT_EQ(list.size(), 0);
+  EXPECT_EQ(list.capacity(), 0);
+
+  list.insert(5);
+  list = std::move(list2);
+  EXPECT_EQ(list.size(), 2);
+  EXPECT_EQ(list[0], 8);
+  EXPECT_EQ(list[1], 21);
+  EXPECT_TRUE(list2.empty());
+}
+
+TEST(btal_functions_suite, merge_union_test) {
+  binary_tree_array_list<int> a;
+  binary_tree_array_list<int> b;
+  for (int i = 0; i < 100; i += 2) {
+    a.insert(i);
+  }
+  for (int i = 0; i < 100; i += 3) {
+    b.insert(i);
+  }
+
+  auto result = a.merge_union(b);
+  std::vector<int> expected;
+  for (int i = 0; i < 100; i++) {
+    if (i % 2 == 0 || i % 3 == 0)
+      expected.push_back(i);
+  }
+  ASSERT_EQ(result.size(), expected.size());
+  size_t i = 0;
+  for (int item : result) {
+    EXPECT_EQ(item, expected[i++]);
+  }
+  EXPECT_EQ(a.size(), 50);
+  EXPECT_EQ(b.size(), 34);
+
+  // Union of a list with itself keeps each duplicate once per occurrence.
+  EXPECT_EQ(b.merge_union(b).size(), b.size());
+  EXPECT_EQ(a.merge_union(binary_tree_array_list<int>()).size(), a.size());
+}
+
+TEST(btal_functions_suite, intersect_test) {
+  binary_tree_array_list<int> a;
+  binary_tree_array_list<int> b;
+  for (int i = 0; i < 100; i += 2) {
+    a.insert(i);
+  }
+  for (int i = 0; i < 100; i += 3) {
+    b.insert(i);
+  }
+
+  auto result = a.intersect(b);
+  int expected = 0;
+  for (int item : result) {
+    EXPECT_EQ(item, expected);
+    expected += 6;
+  }
+  EXPECT_EQ(result.size(), 17);
+  EXPECT_TRUE(a.intersect(binary_tree_array_list<int>()).empty());
+}
+
+TEST(btal_functions_suite, difference_test) {
+  binary_tree_array_list<int> a;
+  binary_tree_array_list<int> b;
+  for (int i = 0; i < 100; i++) {
+    a.insert(i);
+  }
+  for (int i = 0; i < 100; i += 2) {
+    b.insert(i);
+  }
+  a.insert(51);
+
+  auto result = a.difference(b);
+  std::vector<int> items;
+  for (int item : result) {
+    items.push_back(item);
+  }
+  ASSERT_EQ(items.size(), 51);
+  EXPECT_EQ(items[0], 1);
+  EXPECT_EQ(items[25], 51);
+  EXPECT_EQ(items[26], 51);
+  EXPECT_EQ(items[50], 99);
+  EXPECT_TRUE(b.difference(a).empty());
+}
+
+TEST(btal_functions_suite, set_operation_in_place_test) {
+  binary_tree_array_list<int> a;
+  binary_tree_array_list<int> b;
+  for (int i = 0; i < 1'000; i++) {
+    a.insert(i);
+  }
+  for (int i = 500; i < 1'500; i++) {
+    b.insert(i);
+  }
+  size_t capacity = a.capacity();
+
+  a.difference_in_place(b);
+  EXPECT_EQ(a.size(), 500);
+  EXPECT_EQ(a.capacity(), capacity);
+  EXPECT_EQ(a[0], 0);
+  EXPECT_EQ(a[499], 499);
+  EXPECT_FALSE(a.contains(500));
+
+  a.merge_union_in_place(b);
+  EXPECT_EQ(a.size(), 1'500);
+  EXPECT_EQ(a[1'499], 1'499);
+
+  a.intersect_in_place(b);
+  EXPECT_EQ(a.size(), 1'000);
+  EXPECT_EQ(a[0], 500);
+  EXPECT_LE(a.stats().height, 10);
+
+  // The rebuilt tree must keep working as an ordinary list.
+  a.insert(0);
+  EXPECT_TRUE(a.remove(700));
+  EXPECT_EQ(a[0], 0);
+  EXPECT_EQ(a.size(), 1'000);
+}
+
+TEST(btal_functions_suite, split_test) {
+  binary_tree_array_list<int> list;
+  for (int i = 0; i < 100; i++) {
+    list.insert(i);
+  }
+
+  auto [left, right] = list.split(30);
+  EXPECT_EQ(left.size(), 30);
+  EXPECT_EQ(right.size(), 70);
+  EXPECT_EQ(left[0], 0);
+  EXPECT_EQ(left[29], 29);
+  EXPECT_EQ(right[0], 30);
+  EXPECT_EQ(right[69], 99);
+  EXPECT_EQ(list.size(), 100);
+
+  auto [all, none] = list.split(1'000);
+  EXPECT_EQ(all.size(), 100);
+  EXPECT_TRUE(none.empty());
+}
+
+TEST(btal_functions_suite, split_off_test) {
+  // Small right side, small left side and an even split all take different
+  // paths internally.
+  for (int key : {995, 5, 500, -1, 2'000}) {
+    binary_tree_array_list<int> list;
+    for (int i = 0; i < 1'000; i++) {
+      list.insert(i);
+    }
+
+    auto right = list.split_off(key);
+    int pivot = std::clamp(key, 0, 1'000);
+    ASSERT_EQ(list.size(), pivot);
+    ASSERT_EQ(right.size(), 1'000 - pivot);
+    int expected = 0;
+    for (int item : list) {
+      ASSERT_EQ(item, expected++);
+    }
+    for (int item : right) {
+      ASSERT_EQ(item, expected++);
+    }
+
+    list.insert(key);
+    right.insert(key);
+    EXPECT_TRUE(list.contains(key));
+    EXPECT_TRUE(right.remove(key));
+  }
+}
+
+TEST(btal_functions_suite, join_test) {
+  binary_tree_array_list<int> left;
+  binary_tree_array_list<int> right;
+  for (int i = 0; i < 500; i++) {
+    left.insert(i);
+  }
+  for (int i = 500; i < 1'000; i++) {
+    right.insert(i);
+  }
+
+  auto joined = binary_tree_array_list<int>::join(left, right);
+  ASSERT_EQ(joined.size(), 1'000);
+  int expected = 0;
+  for (int item : joined) {
+    ASSERT_EQ(item, expected++);
+  }
+  EXPECT_LE(joined.stats().height, 10);
+
+  binary_tree_array_list<int> tail;
+  tail.insert(1'000);
+  tail.insert(1'001);
+  joined = binary_tree_array_list<int>::join(std::move(joined), tail);
+  ASSERT_EQ(joined.size(), 1'002);
+  EXPECT_EQ(joined[1'001], 1'001);
+
+  EXPECT_THROW(binary_tree_array_list<int>::join(tail, left),
+               std::logic_error);
+  EXPECT_EQ(binary_tree_array_list<int>::join(binary_tree_array_list<int>(),
+                                              tail)
+                .size(),
+            2);
+}
+
+TEST(btal_functions_suite, string_items_test) {
+  // Long enough that every string owns a heap allocation.
+  auto key = [](int i) { return std::string(40, 'a') + std::to_string(i); };
+
+  auto list = binary_tree_array_list<std::string>();
+  for (int i = 0; i < 500; i++) {
+    list.insert(key((i * 37) % 500));
+  }
+  for (int i = 0; i < 500; i += 3) {
+    ASSERT_TRUE(list.remove(key(i)));
+  }
+
+  auto copy = list;
+  auto assigned = binary_tree_array_list<std::string>();
+  assigned.insert("placeholder");
+  assigned = copy;
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  list.insert(key(1));
+
+  for (auto *other : {&copy, &assigned}) {
+    EXPECT_EQ(other->size(), 333);
+    for (int i = 0; i < 500; i++) {
+      ASSERT_EQ(other->contains(key(i)), i % 3 != 0);
+    }
+    EXPECT_TRUE(std::is_sorted(other->begin(), other->end()));
+  }
+}
+
+namespace {
+// Copies throw once a shared budget runs out. The move constructor is not
+// noexcept, so containers copy rather than move it to stay exception-safe.
+struct fragile {
+  static inline int copies_left = -1;
+  int value;
+
+  fragile(int value) : value(value) {}
+  fragile(const fragile &other) : value(other.value) {
+    if (copies_left == 0)
+      throw std::runtime_error("copy failed");
+    if (copies_left > 0)
+      copies_left--;
+  }
+  fragile(fragile &&other) : value(other.value) {}
+  fragile &operator=(const fragile &) = default;
+  fragile &operator=(fragile &&) = default;
+
+  bool operator==(const fragile &other) const { return value == other.value; }
+  bool operator<(const fragile &other) const { return value < other.value; }
+};
+} // namespace
+
+TEST(btal_functions_suite, growth_exception_safety_test) {
+  // Inserted in an order that fills exactly three levels.
+  auto list = binary_tree_array_list<fragile>();
+  for (int value : {3, 1, 5, 0, 2, 4, 6}) {
+    list.insert(fragile(value));
+  }
+  ASSERT_EQ(list.capacity(), 7);
+
+  // The next insert needs a new level, and copying the items over fails.
+  fragile::copies_left = 3;
+  EXPECT_THROW(list.insert(fragile(7)), std::runtime_error);
+  fragile::copies_left = -1;
+  EXPECT_EQ(list.size(), 7);
+  EXPECT_EQ(list.capacity(), 7);
+  for (int i = 0; i < 7; i++) {
+    EXPECT_TRUE(list.contains(fragile(i)));
+  }
+
+  // A copy shares storage until it is first modified, and a failure to copy
+  // the items then leaves it untouched.
+  auto other = list;
+  fragile::copies_left = 2;
+  EXPECT_THROW(other.insert(fragile(100)), std::runtime_error);
+  fragile::copies_left = -1;
+  EXPECT_EQ(other.size(), 7);
+  EXPECT_FALSE(other.contains(fragile(100)));
+
+  list.insert(fragile(7));
+  EXPECT_EQ(list.size(), 8);
+}
+
+TEST(btal_functions_suite, copy_on_write_test) {
+  auto list = binary_tree_array_list<int>();
+  for (int i = 0; i < 1'000; i++) {
+    list.insert(i);
+  }
+  for (int i = 100; i < 1'000; i++) {
+    list.remove(i);
+  }
+  size_t capacity = list.capacity();
+
+  // Copies are independent even though they start out sharing storage.
+  auto snapshot = list;
+  auto assigned = binary_tree_array_list<int>();
+  assigned = list;
+  EXPECT_EQ(snapshot.capacity(), capacity);
+  list.insert(5'000);
+  snapshot.remove(0);
+  assigned.clear();
+
+  EXPECT_EQ(list.size(), 101);
+  EXPECT_TRUE(list.contains(0));
+  EXPECT_TRUE(list.contains(5'000));
+  EXPECT_EQ(snapshot.size(), 99);
+  EXPECT_FALSE(snapshot.contains(0));
+  EXPECT_FALSE(snapshot.contains(5'000));
+  EXPECT_TRUE(assigned.empty());
+  for (int i = 1; i < 100; i++) {
+    ASSERT_TRUE(list.contains(i));
+    ASSERT_TRUE(snapshot.contains(i));
+  }
+
+  // Detaching copies only the levels in use, not the spare capacity.
+  EXPECT_LT(list.capacity(), capacity);
+  EXPECT_LT(snapshot.capacity(), capacity);
+  EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+  EXPECT_TRUE(std::is_sorted(snapshot.begin(), snapshot.end()));
+
+  // Splitting a shared list copies the items it hands out, rather than
+  // moving them out from under the other list.
+  auto original = snapshot;
+  auto upper = snapshot.split_off(50);
+  EXPECT_EQ(original.size(), 99);
+  EXPECT_EQ(snapshot.size() + upper.size(), 99);
+  for (int i = 1; i < 100; i++) {
+    ASSERT_TRUE(original.contains(i));
+  }
+}
+
+TEST(btal_functions_suite, from_sorted_test) {
+  // Large enough to be split across threads.
+  std::vector<int> items(200'000);
+  for (int i = 0; i < 200'000; i++) {
+    items[i] = i * 2;
+  }
+
+  auto list = binary_tree_array_list<int>::from_sorted(items, 4);
+  EXPECT_EQ(list.size(), 200'000);
+  EXPECT_EQ(list.stats().height, 18);
+  for (int i = 0; i < 200'000; i += 7) {
+    ASSERT_TRUE(list.contains(i * 2));
+    ASSERT_FALSE(list.contains(i * 2 + 1));
+  }
+  auto expected = items.begin();
+  for (int item : list) {
+    ASSERT_EQ(item, *expected++);
+  }
+
+  EXPECT_TRUE(binary_tree_array_list<int>::from_sorted({}).empty());
+  EXPECT_THROW(binary_tree_array_list<int>::from_sorted({1, 3, 2}),
+               std::logic_error);
+}
+
+TEST(btal_functions_suite, optimize_test) {
+  auto list = binary_tree_array_list<int>();
+  for (int i = 0; i < 100'000; i++) {
+    list.insert((i * 7'919) % 100'000);
+  }
+  for (int i = 0; i < 100'000; i += 3) {
+    list.remove(i);
+  }
+  size_t capacity = list.capacity();
+
+  list.optimize(4);
+  EXPECT_EQ(list.size(), 66'666);
+  EXPECT_EQ(list.stats().height, 17);
+  EXPECT_EQ(list.capacity(), capacity);
+  for (int i = 0; i < 100'000; i++) {
+    ASSERT_EQ(list.contains(i), i % 3 != 0);
+  }
+  EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+
+  auto empty = binary_tree_array_list<int>();
+  empty.optimize();
+  EXPECT_TRUE(empty.empty());
+}
+
+TEST(btal_functions_suite, for_each_reduce_test) {
+  auto list = binary_tree_array_list<long long>();
+  for (long long i = 1; i <= 100'000; i++) {
+    list.insert(i);
+  }
+
+  std::atomic<long long> sum = 0;
+  list.for_each([&sum](long long item) { sum += item; }, 4);
+  EXPECT_EQ(sum, 5'000'050'000LL);
+
+  EXPECT_EQ(list.reduce(0LL, std::plus<>(), 4), 5'000'050'000LL);
+  EXPECT_EQ(list.reduce(
+                0LL, [](long long a, long long b) { return std::max(a, b); },
+                4),
+            100'000);
+  EXPECT_EQ(binary_tree_array_list<int>().reduce(7, std::plus<>()), 7);
+
+  // Without a thread count, f is only ever called on the calling thread.
+  std::thread::id caller = std::this_thread::get_id();
+  bool elsewhere = false;
+  list.for_each([&](long long) {
+    elsewhere = elsewhere || std::this_thread::get_id() != caller;
+  });
+  EXPECT_FALSE(elsewhere);
+
+  EXPECT_THROW(list.for_each(
+                   [](long long item) {
+                     if (item == 99'999)
+                       throw std::runtime_error("visited");
+                   },
+                   4),
+               std::runtime_error);
+}
+
+TEST(btal_functions_suite, copy_to_test) {
+  auto list = binary_tree_array_list<int>();
+  EXPECT_TRUE(list.to_vector().empty());
+
+  // Random inserts and removes leave holes all over the array.
+  std::mt19937 rng(97);
+  std::vector<int> expected;
+  for (int i = 0; i < 150'000; i++) {
+    int value = rng() % 1'000'000;
+    list.insert(value);
+    expected.push_back(value);
+  }
+  for (int i = 0; i < 50'000; i++) {
+    list.remove(expected.back());
+    expected.pop_back();
+  }
+  std::sort(expected.begin(), expected.end());
+
+  EXPECT_EQ(list.to_vector(1), expected);
+  EXPECT_EQ(list.to_vector(4), expected);
+  EXPECT_EQ(list.to_vector(7), expected);
+  EXPECT_EQ(list.to_vector(0), expected);
+
+  std::vector<int> buffer(list.size() + 1, -1);
+  EXPECT_EQ(list.copy_to(buffer.data(), 4), buffer.data() + list.size());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+  EXPECT_EQ(buffer.back(), -1);
+
+  std::vector<int> appended;
+  list.copy_to(std::back_inserter(appended), 4);
+  EXPECT_EQ(appended, expected);
+}
+
+TEST(btal_functions_suite, min_max_pop_test) {
+  auto list = binary_tree_array_list<int>();
+  EXPECT_EQ(list.min(), std::nullopt);
+  EXPECT_EQ(list.max(), std::nullopt);
+  EXPECT_EQ(list.pop_min(), std::nullopt);
+  EXPECT_EQ(list.pop_max(), std::nullopt);
+
+  std::multiset<int> reference;
+  std::mt19937 rng(1111);
+  for (int i = 0; i < 5'000; i++) {
+    int value = rng() % 1'000;
+    list.insert(value);
+    reference.insert(value);
+    ASSERT_EQ(list.min(), *reference.begin());
+    ASSERT_EQ(list.max(), *reference.rbegin());
+    if (i % 3 == 0) {
+      ASSERT_EQ(list.pop_min(), *reference.begin());
+      reference.erase(reference.begin());
+    } else if (i % 3 == 1) {
+      ASSERT_EQ(list.pop_max(), *reference.rbegin());
+      reference.erase(std::prev(reference.end()));
+    }
+    if (!reference.empty()) {
+      ASSERT_EQ(list.min(), *reference.begin());
+      ASSERT_EQ(list.max(), *reference.rbegin());
+    }
+  }
+
+  // Drain the rest in order.
+  auto copy = list;
+  for (int expected : reference) {
+    ASSERT_EQ(list.pop_min(), expected);
+  }
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.min(), std::nullopt);
+  EXPECT_EQ(copy.size(), reference.size());
+  EXPECT_EQ(copy.min(), *reference.begin());
+}
+
+TEST(btal_functions_suite, min_max_random_test) {
+  auto list = binary_tree_array_list<int>();
+  std::multiset<int> reference;
+  std::mt19937 rng(31);
+
+  // Appends at both ends rotate along the spines, and the small value range
+  // makes the extremes duplicated most of the time.
+  for (int i = 0; i < 30'000; i++) {
+    int value = rng() % 500;
+    switch (rng() % 7) {
+    case 0:
+    case 1:
+      list.insert(value);
+      reference.insert(value);
+      break;
+    case 2:
+      value = reference.empty() ? 0 : *reference.rbegin() + 1;
+      list.insert(value);
+      reference.insert(value);
+      break;
+    case 3:
+      value = reference.empty() ? 0 : *reference.begin() - 1;
+      list.insert(value);
+      reference.insert(value);
+      break;
+    case 4:
+      if (reference.count(value))
+        reference.erase(reference.find(value));
+      list.remove(value);
+      break;
+    case 5:
+      if (!reference.empty()) {
+        ASSERT_EQ(*list.pop_min(), *reference.begin());
+        reference.erase(reference.begin());
+      }
+      break;
+    case 6:
+      if (!reference.empty()) {
+        ASSERT_EQ(*list.pop_max(), *reference.rbegin());
+        reference.erase(std::prev(reference.end()));
+      }
+      break;
+    }
+    ASSERT_EQ(list.size(), reference.size());
+    if (!reference.empty()) {
+      ASSERT_EQ(*list.min(), *reference.begin());
+      ASSERT_EQ(*list.max(), *reference.rbegin());
+    }
+  }
+
+  auto expected = reference.begin();
+  for (int item : list) {
+    ASSERT_EQ(item, *expected++);
+  }
+  EXPECT_EQ(expected, reference.end());
+}
+
+TEST(btal_functions_suite, extract_top_k_test) {
+  for (size_t k : {0, 1, 3, 40, 300, 999, 1'000, 2'000}) {
+    auto list = binary_tree_array_list<int>();
+    for (int i = 999; i >= 0; i--) {
+      list.insert(i);
+    }
+    auto copy = list;
+
+    std::vector<int> top = list.extract_top_k(k);
+    size_t taken = std::min<size_t>(k, 1'000);
+    ASSERT_EQ(top.size(), taken);
+    for (size_t i = 0; i < taken; i++) {
+      ASSERT_EQ(top[i], static_cast<int>(i));
+    }
+    ASSERT_EQ(list.size(), 1'000 - taken);
+    if (taken < 1'000) {
+      EXPECT_EQ(list.min(), static_cast<int>(taken));
+      EXPECT_EQ(list.max(), 999);
+    }
+    EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+    EXPECT_EQ(copy.size(), 1'000);
+  }
+
+  // Neither a new list nor one emptied by removals has a smallest item.
+  auto empty = binary_tree_array_list<int>();
+  EXPECT_TRUE(empty.extract_top_k(5).empty());
+  empty.insert(1);
+  empty.insert(2);
+  empty.remove(1);
+  empty.remove(2);
+  EXPECT_TRUE(empty.extract_top_k(0).empty());
+  EXPECT_TRUE(empty.extract_top_k(5).empty());
+  EXPECT_TRUE(empty.empty());
+}
+
+TEST(btal_functions_suite, erase_test) {
+  binary_tree_array_list<int> list;
+  for (int i = 0; i < 100; i++) {
+    list.insert(i);
+  }
+
+  auto iter = list.begin();
+  for (int i = 0; i < 10; i++) {
+    ++iter;
+  }
+  list.erase(iter);
+  EXPECT_FALSE(list.contains(10));
+  EXPECT_EQ(list.size(), 99);
+
+  while (list.size() > 0) {
+    list.erase(list.begin_at(list.size() / 2));
+    EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+  }
+  EXPECT_THROW(list.erase(list.begin()), std::logic_error);
+
+  binary_tree_array_list<int> other;
+  other.insert(1);
+  list.insert(1);
+  EXPECT_THROW(list.erase(other.begin()), std::logic_error);
+  EXPECT_THROW(list.erase(list.end()), std::logic_error);
+  EXPECT_EQ(list.size(), 1);
+}
+
+TEST(btal_functions_suite, append_test) {
+  binary_tree_array_list<int> ascending;
+  binary_tree_array_list<int> descending;
+  for (int i = 0; i < 10'000; i++) {
+    ascending.insert(i);
+    descending.insert(-i);
+  }
+  ascending.insert(5'000);
+
+  EXPECT_EQ(ascending.size(), 10'001);
+  EXPECT_TRUE(std::is_sorted(ascending.begin(), ascending.end()));
+  EXPECT_TRUE(std::is_sorted(descending.begin(), descending.end()));
+  EXPECT_EQ(descending.min(), -9'999);
+  // An AVL tree of 10^4 items is at most 19 levels deep.
+  EXPECT_LT(ascending.capacity(), size_t(1) << 20);
+  EXPECT_LT(descending.capacity(), size_t(1) << 20);
+}
+
+TEST(btal_functions_suite, hinted_insert_test) {
+  binary_tree_array_list<int> list;
+  std::multiset<int> expected;
+  for (int i = 0; i < 1'000; i += 2) {
+    list.insert(list.end(), i);
+    expected.insert(i);
+  }
+
+  std::mt19937 rng(41);
+  std::uniform_int_distribution<int> dist(0, 1'000);
+  for (int i = 0; i < 1'000; i++) {
+    int value = dist(rng);
+    // The hint is right for about half the values and wrong for the rest.
+    size_t rank = std::distance(expected.begin(), expected.lower_bound(value));
+    if (i % 2 == 1)
+      rank = (rank * 7 + 3) % (expected.size() + 1);
+    list.insert(list.begin_at(rank == expected.size() ? list.size() : rank),
+                value);
+    expected.insert(value);
+  }
+
+  binary_tree_array_list<int> other;
+  other.insert(5);
+  list.insert(other.begin(), 3);
+  expected.insert(3);
+
+  ASSERT_EQ(list.size(), expected.size());
+  auto iter = list.begin();
+  for (int value : expected) {
+    ASSERT_EQ(*iter, value);
+    ++iter;
+  }
+}
@@ -0,0 +1,69 @@
+#include "../src/interval_tree.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace imdast;
+
+TEST(btal_interval_suite, overlapping_test) {
+  interval_tree<int> tree;
+  EXPECT_TRUE(tree.overlapping(5).empty());
+
+  tree.insert({1, 5});
+  tree.insert({3, 3});
+  tree.insert({4, 10});
+  tree.insert({12, 15});
+  tree.insert({6, 7});
+  EXPECT_EQ(tree.size(), 5);
+  EXPECT_EQ(tree.max_end(), 15);
+
+  auto at3 = tree.overlapping(3);
+  ASSERT_EQ(at3.size(), 2);
+  EXPECT_EQ(at3[0], (interval<int>{1, 5}));
+  EXPECT_EQ(at3[1], (interval<int>{3, 3}));
+
+  // Endpoints are included.
+  auto range = tree.overlapping(7, 12);
+  ASSERT_EQ(range.size(), 3);
+  EXPECT_EQ(range[0], (interval<int>{4, 10}));
+  EXPECT_EQ(range[1], (interval<int>{6, 7}));
+  EXPECT_EQ(range[2], (interval<int>{12, 15}));
+
+  EXPECT_TRUE(tree.overlapping(11).empty());
+  EXPECT_TRUE(tree.overlapping(interval<int>{16, 20}).empty());
+
+  EXPECT_TRUE(tree.remove({4, 10}));
+  EXPECT_FALSE(tree.remove({4, 10}));
+  EXPECT_EQ(tree.overlapping(8).size(), 0);
+  EXPECT_THROW(tree.insert({5, 4}), std::logic_error);
+}
+
+TEST(btal_interval_suite, random_test) {
+  interval_tree<int> tree;
+  std::vector<interval<int>> reference;
+  std::mt19937 rng(8642);
+  for (int i = 0; i < 3'000; i++) {
+    int start = rng() % 10'000;
+    interval<int> item{start, start + static_cast<int>(rng() % 300)};
+    tree.insert(item);
+    reference.push_back(item);
+    if (i % 4 == 0) {
+      size_t victim = rng() % reference.size();
+      ASSERT_TRUE(tree.remove(reference[victim]));
+      reference.erase(reference.begin() + victim);
+    }
+  }
+  std::sort(reference.begin(), reference.end());
+
+  for (int query = 0; query < 200; query++) {
+    int lo = rng() % 10'500;
+    int hi = lo + (query % 2 ? 0 : static_cast<int>(rng() % 100));
+    std::vector<interval<int>> expected;
+    for (const auto &item : reference) {
+      if (item.start <= hi && lo <= item.end)
+        expected.push_back(item);
+    }
+    ASSERT_EQ(tree.overlapping(lo, hi), expected);
+  }
+}
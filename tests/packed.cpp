@@ -0,0 +1,119 @@
+#include "../src/packed_binary_tree_array_list.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace imdast;
+
+TEST(btal_packed_suite, insert_remove_test) {
+  auto list = packed_binary_tree_array_list<int>();
+
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.height(), 0);
+  for (int i = 0; i < 1'000; i++) {
+    list.insert(i);
+  }
+  EXPECT_EQ(list.size(), 1'000);
+  EXPECT_EQ(list.height(), 10);
+  for (int i = 0; i < 1'000; i++) {
+    ASSERT_TRUE(list.contains(i));
+  }
+  EXPECT_FALSE(list.contains(1'000));
+
+  for (int i = 0; i < 1'000; i += 2) {
+    ASSERT_TRUE(list.remove(i));
+  }
+  EXPECT_FALSE(list.remove(0));
+  EXPECT_EQ(list.size(), 500);
+  int expected = 1;
+  for (int item : list) {
+    ASSERT_EQ(item, expected);
+    expected += 2;
+  }
+
+  for (int i = 1; i < 1'000; i += 2) {
+    ASSERT_TRUE(list.remove(i));
+  }
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.height(), 0);
+  EXPECT_EQ(list.begin(), list.end());
+}
+
+TEST(btal_packed_suite, random_test) {
+  auto list = packed_binary_tree_array_list<int>();
+  auto expected = std::multiset<int>();
+  auto rng = std::mt19937(7);
+  auto value = std::uniform_int_distribution<int>(0, 500);
+
+  for (int i = 0; i < 20'000; i++) {
+    int item = value(rng);
+    if (rng() % 3) {
+      list.insert(item);
+      expected.insert(item);
+    } else {
+      auto found = expected.find(item);
+      ASSERT_EQ(list.remove(item), found != expected.end());
+      if (found != expected.end())
+        expected.erase(found);
+    }
+    ASSERT_EQ(list.size(), expected.size());
+  }
+  auto items = std::vector<int>();
+  for (int item : list) {
+    items.push_back(item);
+  }
+  EXPECT_EQ(items, std::vector<int>(expected.begin(), expected.end()));
+
+  auto copy = list;
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(copy.size(), expected.size());
+  items.clear();
+  for (int item : copy) {
+    items.push_back(item);
+  }
+  EXPECT_EQ(items, std::vector<int>(expected.begin(), expected.end()));
+}
+
+TEST(btal_packed_suite, same_shape_test) {
+  auto packed = packed_binary_tree_array_list<int>();
+  auto list = binary_tree_array_list<int>();
+  auto items = std::vector<int>(5'000);
+  std::iota(items.begin(), items.end(), 0);
+  std::shuffle(items.begin(), items.end(), std::mt19937(3));
+
+  // With distinct items, balance factors drive the same rotations as stored
+  // heights do.
+  for (int item : items) {
+    packed.insert(item);
+    list.insert(item);
+    ASSERT_EQ(packed.height(), list.stats().height);
+  }
+  EXPECT_EQ(packed.capacity(), list.capacity());
+  std::shuffle(items.begin(), items.end(), std::mt19937(4));
+  for (int item : items) {
+    ASSERT_TRUE(packed.remove(item));
+    ASSERT_TRUE(list.remove(item));
+    ASSERT_EQ(packed.height(), list.stats().height);
+  }
+}
+
+TEST(btal_packed_suite, bytes_test) {
+  auto packed = packed_binary_tree_array_list<int>();
+  auto list = binary_tree_array_list<int>();
+  for (int i = 0; i < 10'000; i++) {
+    packed.insert(i);
+    list.insert(i);
+  }
+  EXPECT_EQ(packed.bytes(), packed.capacity() * sizeof(int) +
+                                (packed.capacity() + 4) / 4);
+  EXPECT_LT(packed.bytes() * 2, list.stats().bytes_allocated);
+
+  auto moved = std::move(packed);
+  EXPECT_EQ(moved.size(), 10'000);
+  EXPECT_TRUE(packed.empty());
+  EXPECT_EQ(packed.bytes(), 0);
+}
@@ -0,0 +1,98 @@
+#include "../src/replicated_binary_tree_array_list.h"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace imdast;
+
+TEST(btal_replicated_suite, synchronous_test) {
+  auto list = replicated_binary_tree_array_list<int>();
+
+  EXPECT_GE(list.replica_count(), 1);
+  EXPECT_FALSE(list.contains(5));
+  for (int i = 0; i < 1'000; i++) {
+    list.insert(i * 2);
+    ASSERT_TRUE(list.contains(i * 2));
+  }
+  EXPECT_EQ(list.size(), 1'000);
+  EXPECT_EQ(list.pending(), 0);
+
+  EXPECT_TRUE(list.remove(10));
+  EXPECT_FALSE(list.remove(10));
+  EXPECT_FALSE(list.contains(10));
+  EXPECT_EQ(list.read([](const auto &replica) { return replica.max(); }),
+            1'998);
+
+  list.clear();
+  EXPECT_EQ(list.size(), 0);
+}
+
+TEST(btal_replicated_suite, batched_test) {
+  binary_tree_array_list<int> initial;
+  initial.insert(1);
+  auto list = replicated_binary_tree_array_list<int>(initial, 4);
+  EXPECT_TRUE(list.contains(1));
+
+  for (int i = 2; i < 5; i++) {
+    list.insert(i);
+  }
+  // The batch is not full yet, so lookups miss the latest writes.
+  EXPECT_EQ(list.pending(), 3);
+  EXPECT_FALSE(list.contains(4));
+  EXPECT_TRUE(list.primary().contains(4));
+
+  list.insert(5);
+  EXPECT_EQ(list.pending(), 0);
+  EXPECT_TRUE(list.contains(4));
+  EXPECT_EQ(list.size(), 5);
+
+  EXPECT_TRUE(list.remove(1));
+  EXPECT_TRUE(list.contains(1));
+  list.publish();
+  EXPECT_FALSE(list.contains(1));
+
+  // A clear drops the writes logged before it, and is replayed in order with
+  // the ones after it.
+  list.insert(6);
+  list.clear();
+  list.insert(7);
+  EXPECT_EQ(list.pending(), 2);
+  list.publish();
+  EXPECT_EQ(list.size(), 1);
+  EXPECT_TRUE(list.contains(7));
+  EXPECT_FALSE(list.contains(6));
+
+  // Replicas do not share storage with the primary list or the source.
+  EXPECT_EQ(initial.size(), 1);
+}
+
+TEST(btal_replicated_suite, concurrent_test) {
+  for (size_t batch : {0, 16}) {
+    auto list = replicated_binary_tree_array_list<int>(batch);
+    for (int i = 0; i < 1'000; i++) {
+      list.insert(i);
+    }
+    list.publish();
+
+    // Items below 1'000 are never removed, so readers must always find them.
+    std::atomic<bool> failed = false;
+    std::vector<std::jthread> readers;
+    for (int r = 0; r < 4; r++) {
+      readers.emplace_back([&list, &failed, r] {
+        for (int i = 0; i < 20'000; i++) {
+          if (!list.contains((i * 7 + r) % 1'000))
+            failed = true;
+        }
+      });
+    }
+    for (int i = 1'000; i < 3'000; i++) {
+      list.insert(i);
+      if (i % 3 == 0)
+        list.remove(i);
+    }
+    readers.clear();
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(list.primary().size(), 3'000 - 666);
+  }
+}
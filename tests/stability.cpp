@@ -1,5 +1,8 @@
 #include "../src/binary_tree_array_list.h"
+#include <cmath>
 #include <gtest/gtest.h>
+#include <random>
+#include <set>
 
 using namespace imdast;
 
@@ -257,3 +260,134 @@ TEST(btal_stability_suite, complex_balance_test) {
   ASSERT_EQ(list[13], 9296);
   ASSERT_EQ(list[14], 9375);
 }
+
+TEST(btal_stability_suite, random_insert_remove_test) {
+  auto list = binary_tree_array_list<int>();
+  std::multiset<int> reference;
+  std::mt19937 rng(12345);
+
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 500; i++) {
+      int value = rng() % 1'000;
+      list.insert(value);
+      reference.insert(value);
+    }
+    for (int i = 0; i < 400; i++) {
+      int value = rng() % 1'000;
+      bool present = reference.count(value) > 0;
+      ASSERT_EQ(list.remove(value), present);
+      if (present)
+        reference.erase(reference.find(value));
+    }
+
+    ASSERT_EQ(list.size(), reference.size());
+    auto expected = reference.begin();
+    for (int item : list) {
+      ASSERT_EQ(item, *expected++);
+    }
+    auto iter = list.end();
+    for (auto it = reference.rbegin(); it != reference.rend(); it++) {
+      ASSERT_TRUE(iter.prev());
+      ASSERT_EQ(*iter, *it);
+    }
+    EXPECT_FALSE(iter.prev());
+
+    // An AVL tree is never taller than ~1.44 log2(n + 2).
+    double bound = 1.4405 * std::log2(list.size() + 2.0);
+    ASSERT_LE(list.stats().height, bound);
+  }
+}
+
+TEST(btal_stability_suite, deep_shift_test) {
+  auto list = binary_tree_array_list<int>();
+
+  // The last insert rotates right at the root, moving a right subtree three
+  // levels deep down a level. Moving it depth-first wrote the left child's
+  // items into slots still holding the right child's.
+  for (int item : {8, 4, 2, 7, 9, 5, 3, 0, 6, 1}) {
+    list.insert(item);
+  }
+
+  ASSERT_EQ(list.size(), 10);
+  int expected = 0;
+  for (int item : list) {
+    ASSERT_EQ(item, expected++);
+  }
+  ASSERT_EQ(expected, 10);
+}
+
+TEST(btal_stability_suite, remove_without_right_child_test) {
+  auto list = binary_tree_array_list<int>();
+
+  // 4 has no right child once 5 is gone, so its left subtree must take its
+  // slot rather than be dropped with it.
+  for (int item : {2, 1, 4, 0, 3, 5}) {
+    list.insert(item);
+  }
+  ASSERT_TRUE(list.remove(5));
+  ASSERT_TRUE(list.remove(4));
+
+  ASSERT_EQ(list.size(), 4);
+  ASSERT_EQ(list[0], 0);
+  ASSERT_EQ(list[1], 1);
+  ASSERT_EQ(list[2], 2);
+  ASSERT_EQ(list[3], 3);
+  ASSERT_TRUE(list.contains(3));
+  ASSERT_EQ(list.stats().height, 3);
+
+  ASSERT_TRUE(list.remove(1));
+  ASSERT_TRUE(list.remove(0));
+  ASSERT_EQ(list.size(), 2);
+  ASSERT_EQ(list[0], 2);
+  ASSERT_EQ(list[1], 3);
+  ASSERT_EQ(list.stats().height, 2);
+}
+
+TEST(btal_stability_suite, balanced_child_rotation_test) {
+  auto list = binary_tree_array_list<int>();
+
+  // Removing 11 leaves the root left-heavy over a balanced left child, which
+  // needs a single right rotation. A left-right rotation would leave 4 with
+  // 2's subtree on one side and nothing on the other.
+  for (int item : {8, 4, 10, 2, 6, 11, 1, 3, 7}) {
+    list.insert(item);
+  }
+  ASSERT_TRUE(list.remove(11));
+
+  ASSERT_EQ(list.size(), 8);
+  int expected[] = {1, 2, 3, 4, 6, 7, 8, 10};
+  for (size_t i = 0; i < 8; i++) {
+    ASSERT_EQ(list[i], expected[i]);
+  }
+  auto stats = list.stats();
+  ASSERT_EQ(stats.height, 4);
+  ASSERT_EQ(stats.level_fill[2], 1.0);
+}
+
+TEST(btal_stability_suite, duplicate_iteration_test) {
+  auto list = binary_tree_array_list<int>();
+
+  // With equal items on both sides of a node, climbing the tree cannot tell
+  // by value whether it came from the left or the right.
+  for (int i = 0; i < 7; i++) {
+    list.insert(1);
+  }
+  list.insert(0);
+  list.insert(2);
+
+  int expected[] = {0, 1, 1, 1, 1, 1, 1, 1, 2};
+  size_t count = 0;
+  for (int item : list) {
+    ASSERT_LT(count, 9);
+    ASSERT_EQ(item, expected[count++]);
+  }
+  ASSERT_EQ(count, 9);
+
+  auto iter = list.end();
+  while (iter.has_prev()) {
+    ASSERT_GT(count, 0);
+    ASSERT_TRUE(iter.prev());
+    ASSERT_EQ(*iter, expected[--count]);
+  }
+  ASSERT_EQ(count, 0);
+}
@@ -0,0 +1,103 @@
+#include "../src/staged_binary_tree_array_list.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+using namespace imdast;
+
+TEST(btal_staged_suite, insert_contains_test) {
+  auto list = staged_binary_tree_array_list<int>(16);
+
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(list.contains(5));
+  for (int i = 0; i < 10; i++) {
+    list.insert(i * 2);
+  }
+  // Nothing has reached the tree yet.
+  EXPECT_EQ(list.buffered(), 10);
+  EXPECT_TRUE(list.tree().empty());
+  EXPECT_EQ(list.size(), 10);
+  EXPECT_TRUE(list.contains(4));
+  EXPECT_FALSE(list.contains(5));
+
+  for (int i = 10; i < 1'000; i++) {
+    list.insert(i * 2);
+  }
+  EXPECT_EQ(list.size(), 1'000);
+  EXPECT_LT(list.buffered(), 16);
+  for (int i = 0; i < 1'000; i++) {
+    ASSERT_TRUE(list.contains(i * 2));
+    ASSERT_FALSE(list.contains(i * 2 + 1));
+  }
+
+  // Merges lay the tree out as a perfectly balanced tree.
+  list.flush();
+  EXPECT_EQ(list.buffered(), 0);
+  EXPECT_EQ(list.tree().capacity(), 1'023);
+
+  EXPECT_THROW(staged_binary_tree_array_list<int>(0), std::logic_error);
+}
+
+TEST(btal_staged_suite, remove_test) {
+  auto list = staged_binary_tree_array_list<int>(8);
+
+  EXPECT_FALSE(list.remove(5));
+  list.insert(5);
+  EXPECT_TRUE(list.remove(5));
+  EXPECT_FALSE(list.remove(5));
+  EXPECT_EQ(list.buffered(), 0);
+
+  for (int i = 0; i < 3; i++) {
+    list.insert(7);
+  }
+  list.flush();
+  EXPECT_TRUE(list.remove(7));
+  EXPECT_TRUE(list.remove(7));
+  EXPECT_TRUE(list.contains(7));
+  EXPECT_TRUE(list.remove(7));
+  EXPECT_FALSE(list.contains(7));
+  EXPECT_FALSE(list.remove(7));
+  EXPECT_EQ(list.size(), 0);
+  EXPECT_EQ(list.tree().size(), 3);
+  list.flush();
+  EXPECT_TRUE(list.tree().empty());
+}
+
+TEST(btal_staged_suite, random_test) {
+  auto list = staged_binary_tree_array_list<std::string>(32);
+  std::multiset<std::string> expected;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dist(0, 300);
+
+  for (int i = 0; i < 10'000; i++) {
+    std::string value = std::to_string(dist(rng));
+    if (i % 3 == 0) {
+      auto found = expected.find(value);
+      ASSERT_EQ(list.remove(value), found != expected.end());
+      if (found != expected.end())
+        expected.erase(found);
+    } else {
+      list.insert(value);
+      expected.insert(value);
+    }
+    ASSERT_EQ(list.size(), expected.size());
+    ASSERT_EQ(list.contains(value), expected.contains(value));
+  }
+
+  std::vector<std::string> items = list.to_vector();
+  EXPECT_TRUE(std::equal(items.begin(), items.end(), expected.begin(),
+                         expected.end()));
+  auto reference = expected.begin();
+  for (const std::string &item : list) {
+    ASSERT_EQ(item, *reference++);
+  }
+  EXPECT_EQ(reference, expected.end());
+  EXPECT_EQ(list.buffered(), 0);
+
+  auto copy = list;
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(copy.size(), expected.size());
+}
@@ -0,0 +1,125 @@
+#include "../src/binary_tree_array_list.h"
+#include "../src/static_binary_tree_array_list.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+
+using namespace imdast;
+
+namespace {
+// Built entirely at compile time.
+constexpr auto ports = [] {
+  static_binary_tree_array_list<int, 4> list;
+  for (int port : {443, 22, 80, 8080, 53, 25})
+    list.insert(port);
+  return list;
+}();
+
+static_assert(ports.size() == 6);
+static_assert(ports.contains(80));
+static_assert(!ports.contains(81));
+static_assert(*ports.begin() == 22);
+
+// Removing at compile time moves successors and subtrees through the same
+// shift() and retrace() as insert().
+constexpr auto trimmed = [] {
+  auto list = ports;
+  list.remove(22);
+  list.remove(443);
+  return list;
+}();
+
+static_assert(trimmed.size() == 4);
+static_assert(!trimmed.contains(443));
+static_assert(*trimmed.begin() == 25);
+} // namespace
+
+TEST(btal_static_suite, constexpr_test) {
+  int expected[] = {22, 25, 53, 80, 443, 8080};
+  size_t i = 0;
+  for (int port : ports) {
+    ASSERT_LT(i, std::size(expected));
+    EXPECT_EQ(port, expected[i++]);
+  }
+  EXPECT_EQ(i, std::size(expected));
+}
+
+TEST(btal_static_suite, full_test) {
+  static_binary_tree_array_list<int, 3> list;
+  EXPECT_EQ(list.capacity(), 7);
+
+  // Inserted in an order that needs no rotations, all seven slots fill up.
+  for (int value : {3, 1, 5, 0, 2, 4, 6}) {
+    ASSERT_TRUE(list.insert(value));
+  }
+  EXPECT_FALSE(list.insert(7));
+  EXPECT_EQ(list.size(), 7);
+  for (int i = 0; i < 7; i++) {
+    EXPECT_TRUE(list.contains(i));
+  }
+  EXPECT_FALSE(list.contains(7));
+
+  EXPECT_TRUE(list.remove(6));
+  EXPECT_TRUE(list.insert(7));
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.begin(), list.end());
+
+  // In sorted order, the fifth item would be placed a level too deep before
+  // rebalancing, so it is refused even though slots are free.
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(list.insert(i));
+  }
+  EXPECT_FALSE(list.insert(4));
+  EXPECT_EQ(list.size(), 4);
+}
+
+TEST(btal_static_suite, random_insert_remove_test) {
+  static_binary_tree_array_list<int, 12> list;
+  std::multiset<int> reference;
+  std::mt19937 rng(2468);
+  for (int i = 0; i < 20'000; i++) {
+    int value = rng() % 500;
+    if (rng() % 3 == 0) {
+      bool present = reference.count(value);
+      if (present)
+        reference.erase(reference.find(value));
+      ASSERT_EQ(list.remove(value), present);
+    } else if (list.insert(value)) {
+      reference.insert(value);
+    }
+    ASSERT_EQ(list.size(), reference.size());
+    ASSERT_LE(list.height(), 1.4405 * std::log2(list.size() + 2));
+  }
+
+  auto expected = reference.begin();
+  for (int item : list) {
+    ASSERT_EQ(item, *expected++);
+  }
+  EXPECT_EQ(expected, reference.end());
+}
+
+TEST(btal_static_suite, same_shape_test) {
+  // Both lists balance through array_tree_base, so the same operations leave
+  // them the same height with the same items.
+  static_binary_tree_array_list<int, 12> fixed;
+  binary_tree_array_list<int> list;
+  std::mt19937 rng(1357);
+  for (int i = 0; i < 5'000; i++) {
+    int value = rng() % 300;
+    if (rng() % 3 == 0) {
+      ASSERT_EQ(fixed.remove(value), list.remove(value));
+    } else if (fixed.insert(value)) {
+      list.insert(value);
+    }
+    ASSERT_EQ(fixed.height(), list.stats().height);
+  }
+
+  auto item = list.begin();
+  for (int value : fixed) {
+    ASSERT_EQ(value, *item);
+    ++item;
+  }
+  EXPECT_EQ(item, list.end());
+}
@@ -0,0 +1,111 @@
+#include "../src/string_binary_tree_array_list.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace imdast;
+
+TEST(btal_strings_suite, key_order_test) {
+  // Short keys, keys ending in zero bytes, and keys that only differ past the
+  // inline prefix all order as std::string does.
+  auto strings = std::vector<std::string>{
+      "",         "a",         std::string("a\0", 2),
+      "ab",       "abcdefgh",  std::string("abcdefgh\0", 9),
+      "abcdefghi", "abcdefghj", "abcdefghij",
+      "b",        "\xff",      "\xff\xff\xff\xff\xff\xff\xff\xff\x01"};
+  for (const auto &left : strings) {
+    for (const auto &right : strings) {
+      ASSERT_EQ(string_key(left) < string_key(right), left < right)
+          << left << " " << right;
+      ASSERT_EQ(string_key(left) == string_key(right), left == right);
+    }
+    EXPECT_EQ(string_key(left).str(), left);
+  }
+}
+
+TEST(btal_strings_suite, insert_remove_test) {
+  auto list = string_binary_tree_array_list();
+
+  EXPECT_TRUE(list.empty());
+  list.insert("pear");
+  list.insert("apple");
+  list.insert("a fairly long string that lives in the arena");
+  list.insert("apple");
+  EXPECT_EQ(list.size(), 4);
+  EXPECT_TRUE(list.contains("pear"));
+  EXPECT_FALSE(list.contains("pea"));
+  EXPECT_TRUE(list.contains("a fairly long string that lives in the arena"));
+  EXPECT_FALSE(list.contains("a fairly long string that lives in the arenas"));
+  EXPECT_EQ(list.to_vector(),
+            (std::vector<std::string>{
+                "a fairly long string that lives in the arena", "apple",
+                "apple", "pear"}));
+
+  EXPECT_TRUE(list.remove("apple"));
+  EXPECT_TRUE(list.remove("a fairly long string that lives in the arena"));
+  EXPECT_FALSE(list.remove("a fairly long string"));
+  EXPECT_EQ(list.to_vector(), (std::vector<std::string>{"apple", "pear"}));
+
+  auto moved = std::move(list);
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.arena_bytes(), 0);
+  list.insert("still usable after the move");
+  EXPECT_TRUE(list.contains("still usable after the move"));
+  EXPECT_EQ(moved.size(), 2);
+}
+
+TEST(btal_strings_suite, random_test) {
+  auto list = string_binary_tree_array_list();
+  auto expected = std::multiset<std::string>();
+  auto rng = std::mt19937(11);
+  auto strings = std::vector<std::string>();
+  for (int i = 0; i < 2'000; i++) {
+    // Shared prefixes force comparisons onto the tails.
+    strings.push_back((i % 2 ? "user:000" : "u") + std::to_string(i * 7919) +
+                      std::string(rng() % 64, 'x'));
+  }
+
+  for (int i = 0; i < 50'000; i++) {
+    const auto &str = strings[rng() % strings.size()];
+    if (rng() % 2) {
+      list.insert(str);
+      expected.insert(str);
+    } else {
+      auto found = expected.find(str);
+      ASSERT_EQ(list.remove(str), found != expected.end());
+      if (found != expected.end())
+        expected.erase(found);
+    }
+  }
+  EXPECT_EQ(list.size(), expected.size());
+  EXPECT_EQ(list.to_vector(),
+            std::vector<std::string>(expected.begin(), expected.end()));
+  for (const auto &str : strings) {
+    ASSERT_EQ(list.contains(str), expected.contains(str));
+  }
+}
+
+TEST(btal_strings_suite, compact_test) {
+  auto list = string_binary_tree_array_list();
+  auto long_string = std::string(1'000, 'x');
+  for (int i = 0; i < 1'000; i++) {
+    list.insert(std::to_string(i) + long_string);
+  }
+  size_t grown = list.arena_bytes();
+  EXPECT_GE(grown, 1'000 * 1'000);
+
+  // Removing most keys compacts the arena down to what is still in use.
+  for (int i = 0; i < 900; i++) {
+    ASSERT_TRUE(list.remove(std::to_string(i) + long_string));
+  }
+  EXPECT_LT(list.arena_bytes(), grown / 2);
+  for (int i = 900; i < 1'000; i++) {
+    ASSERT_TRUE(list.contains(std::to_string(i) + long_string));
+  }
+
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.arena_bytes(), 0);
+}
@@ -0,0 +1,173 @@
+#include "../src/trace.h"
+#include <cstdio>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace imdast;
+
+static std::string trace_path(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(btal_trace_suite, round_trip_test) {
+  std::string path = trace_path("imdast-round-trip.trace");
+  {
+    trace_recorder<int64_t> recorder(path);
+    int64_t values[] = {5, -3, 7};
+    recorder.record(trace_op::INSERT, &values[0], 0);
+    recorder.record(trace_op::CONTAINS, &values[1], 0);
+    recorder.record(trace_op::AT, nullptr, 42);
+    recorder.record(trace_op::REMOVE, &values[2], 0);
+    recorder.record(trace_op::ITERATE, nullptr, 0);
+    recorder.record(trace_op::STEP, nullptr, 3);
+    EXPECT_EQ(recorder.records(), 6);
+    recorder.flush();
+    EXPECT_TRUE(recorder.good());
+  }
+
+  EXPECT_EQ(trace_reader<int64_t>::item_size(path), sizeof(int64_t));
+  trace_reader<int64_t> reader(path);
+  trace_entry<int64_t> entry;
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.op, trace_op::INSERT);
+  EXPECT_EQ(entry.value, 5);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.op, trace_op::CONTAINS);
+  EXPECT_EQ(entry.value, -3);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.op, trace_op::AT);
+  EXPECT_EQ(entry.index, 42);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.op, trace_op::REMOVE);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.op, trace_op::ITERATE);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.op, trace_op::STEP);
+  EXPECT_EQ(entry.index, 3);
+  EXPECT_FALSE(reader.next(entry));
+
+  EXPECT_THROW(trace_reader<int32_t>{path}, std::logic_error);
+  FILE *file = std::fopen(path.c_str(), "ab");
+  std::fputc(static_cast<int>(trace_op::FIND), file);
+  std::fputc(1, file);
+  std::fclose(file);
+  trace_reader<int64_t> truncated(path);
+  for (int i = 0; i < 6; i++) {
+    truncated.next(entry);
+  }
+  EXPECT_THROW(truncated.next(entry), std::logic_error);
+  std::remove(path.c_str());
+}
+
+TEST(btal_trace_suite, concurrent_record_test) {
+  std::string path = trace_path("imdast-concurrent.trace");
+  {
+    // Readers of one list may record at once; records must not interleave.
+    trace_recorder<int64_t> recorder(path);
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&recorder, t] {
+        for (int64_t i = 0; i < 10'000; i++) {
+          int64_t value = t * 10'000 + i;
+          recorder.record(trace_op::CONTAINS, &value, 0);
+          recorder.record(trace_op::AT, nullptr, value);
+        }
+      });
+    }
+    threads.clear();
+    EXPECT_EQ(recorder.records(), 80'000);
+  }
+
+  trace_reader<int64_t> reader(path);
+  trace_entry<int64_t> entry;
+  size_t count = 0;
+  while (reader.next(entry)) {
+    if (entry.op == trace_op::CONTAINS) {
+      ASSERT_LT(entry.value, 40'000);
+    } else {
+      ASSERT_EQ(entry.op, trace_op::AT);
+      ASSERT_LT(entry.index, 40'000);
+    }
+    count++;
+  }
+  EXPECT_EQ(count, 80'000);
+  std::remove(path.c_str());
+}
+
+TEST(btal_trace_suite, write_failure_test) {
+  // Every write to /dev/full fails once the buffer is flushed.
+  if (!std::filesystem::exists("/dev/full"))
+    GTEST_SKIP();
+  trace_recorder<int64_t> recorder("/dev/full");
+  int64_t value = 1;
+  recorder.record(trace_op::INSERT, &value, 0);
+  EXPECT_TRUE(recorder.good());
+  recorder.flush();
+  EXPECT_FALSE(recorder.good());
+  recorder.record(trace_op::INSERT, &value, 0);
+  EXPECT_EQ(recorder.records(), 1);
+}
+
+#ifdef IMDAST_BTAL_TRACE
+TEST(btal_trace_suite, hooks_test) {
+  std::string path = trace_path("imdast-hooks.trace");
+  {
+    trace_recorder<int> recorder(path);
+    binary_tree_array_list<int> list;
+    list.insert(1);
+    list.trace(&recorder);
+    list.insert(2);
+    list.insert(0);
+    list.contains(2);
+    list.find(3);
+    list[1];
+    for (int item : list) {
+      (void)item;
+    }
+    list.remove(0);
+    list.erase(list.begin_at(1));
+    list.insert(3);
+    list.insert(5);
+    list.pop_max();
+    list.extract_top_k(1);
+    {
+      // A copy reports the steps it takes itself.
+      auto iter = list.begin();
+      auto second = iter;
+      ++second;
+    }
+    auto copy = list;
+    copy.insert(9);
+    list.trace(nullptr);
+    list.insert(4);
+  }
+
+  trace_op expected[] = {
+      trace_op::INSERT, trace_op::INSERT,  trace_op::CONTAINS,
+      trace_op::FIND,   trace_op::AT,      trace_op::ITERATE,
+      trace_op::STEP,   trace_op::REMOVE,  trace_op::ITERATE,
+      trace_op::REMOVE, trace_op::INSERT,  trace_op::INSERT,
+      trace_op::REMOVE, trace_op::REMOVE,  trace_op::ITERATE,
+      trace_op::STEP};
+  uint64_t steps[] = {3, 1};
+  int removed[] = {0, 2, 5, 1};
+  size_t step = 0, removal = 0;
+  trace_reader<int> reader(path);
+  trace_entry<int> entry;
+  for (trace_op op : expected) {
+    ASSERT_TRUE(reader.next(entry));
+    ASSERT_EQ(entry.op, op);
+    if (op == trace_op::STEP) {
+      EXPECT_EQ(entry.index, steps[step++]);
+    } else if (op == trace_op::REMOVE) {
+      EXPECT_EQ(entry.value, removed[removal++]);
+    }
+  }
+  EXPECT_FALSE(reader.next(entry));
+  std::remove(path.c_str());
+}
+#endif
@@ -0,0 +1,206 @@
+#include "../src/binary_tree_array_list.h"
+#include "../src/compressed_view.h"
+#include "../src/s_tree_view.h"
+#include "../src/veb_view.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <set>
+
+using namespace imdast;
+
+TEST(btal_views_suite, veb_empty_test) {
+  veb_view<int> empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_FALSE(empty.contains(0));
+
+  veb_view<int> from_empty((binary_tree_array_list<int>()));
+  EXPECT_EQ(from_empty.size(), 0);
+  EXPECT_FALSE(from_empty.contains(0));
+}
+
+TEST(btal_views_suite, veb_contains_test) {
+  // Cover every height up to 13, including odd and even splits.
+  for (int n : {1, 2, 3, 7, 8, 100, 1'000, 5'000}) {
+    binary_tree_array_list<int> list;
+    for (int i = 0; i < n; i++) {
+      list.insert(i * 2);
+    }
+    veb_view<int> view(list);
+    ASSERT_EQ(view.size(), n);
+    for (int i = 0; i < n; i++) {
+      ASSERT_TRUE(view.contains(i * 2));
+      ASSERT_FALSE(view.contains(i * 2 + 1));
+    }
+    EXPECT_FALSE(view.contains(-1));
+  }
+}
+
+TEST(btal_views_suite, veb_random_test) {
+  binary_tree_array_list<int> list;
+  std::set<int> reference;
+  std::mt19937 rng(2468);
+  for (int i = 0; i < 3'000; i++) {
+    int value = rng() % 10'000;
+    list.insert(value);
+    reference.insert(value);
+  }
+  for (int i = 0; i < 1'000; i++) {
+    int value = rng() % 10'000;
+    while (list.remove(value)) {
+    }
+    reference.erase(value);
+  }
+
+  veb_view<int> view(list);
+  for (int value = 0; value < 10'000; value++) {
+    ASSERT_EQ(view.contains(value), reference.count(value) > 0);
+  }
+}
+
+TEST(btal_views_suite, s_tree_empty_test) {
+  s_tree_view<int> empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_FALSE(empty.contains(0));
+  EXPECT_EQ(empty.rank(0), 0);
+  EXPECT_EQ(empty.lower_bound(0), std::nullopt);
+  EXPECT_EQ(empty.begin(), empty.end());
+}
+
+TEST(btal_views_suite, s_tree_search_test) {
+  // Sizes around node and layer boundaries (16, 16 * 17, 16 * 17 * 17).
+  for (int n : {1, 15, 16, 17, 272, 273, 4'624, 4'625, 20'000}) {
+    binary_tree_array_list<int> list;
+    for (int i = 0; i < n; i++) {
+      list.insert(i * 2);
+    }
+    s_tree_view<int> view(list);
+    ASSERT_EQ(view.size(), n);
+    for (int i = 0; i < n; i++) {
+      ASSERT_TRUE(view.contains(i * 2));
+      ASSERT_FALSE(view.contains(i * 2 + 1));
+      ASSERT_EQ(view.rank(i * 2), i);
+      ASSERT_EQ(view.rank(i * 2 + 1), i + 1);
+      ASSERT_EQ(view.lower_bound(i * 2 - 1), std::make_optional(i * 2));
+    }
+    EXPECT_EQ(view.rank(-5), 0);
+    EXPECT_EQ(view.rank(n * 2), n);
+    EXPECT_EQ(view.lower_bound(n * 2), std::nullopt);
+  }
+}
+
+TEST(btal_views_suite, s_tree_scan_test) {
+  binary_tree_array_list<int> list;
+  std::multiset<int> reference;
+  std::mt19937 rng(1357);
+  for (int i = 0; i < 5'000; i++) {
+    int value = rng() % 2'000;
+    list.insert(value);
+    reference.insert(value);
+  }
+
+  s_tree_view<int> view(list);
+  ASSERT_EQ(view.end() - view.begin(), 5'000);
+  auto expected = reference.begin();
+  for (int item : view) {
+    ASSERT_EQ(item, *expected++);
+  }
+  for (int value = -1; value <= 2'000; value++) {
+    ASSERT_EQ(view.rank(value),
+              std::distance(reference.begin(), reference.lower_bound(value)));
+  }
+
+  // Range scan over [500, 600).
+  const int *first = view.begin() + view.rank(500);
+  const int *last = view.begin() + view.rank(600);
+  EXPECT_EQ(last - first, std::distance(reference.lower_bound(500),
+                                        reference.lower_bound(600)));
+  for (const int *it = first; it != last; it++) {
+    ASSERT_GE(*it, 500);
+    ASSERT_LT(*it, 600);
+  }
+}
+
+TEST(btal_views_suite, compressed_empty_test) {
+  compressed_view<int> empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_FALSE(empty.contains(0));
+
+  compressed_view<int> from_empty((binary_tree_array_list<int>()));
+  EXPECT_EQ(from_empty.size(), 0);
+  EXPECT_FALSE(from_empty.contains(0));
+}
+
+TEST(btal_views_suite, compressed_contains_test) {
+  // Cover heights on both sides of every block boundary.
+  for (int n : {1, 2, 15, 16, 100, 1'000, 5'000}) {
+    binary_tree_array_list<int> list;
+    for (int i = 0; i < n; i++) {
+      list.insert(i * 2);
+    }
+    compressed_view<int> view(list);
+    ASSERT_EQ(view.size(), n);
+    for (int i = 0; i < n; i++) {
+      ASSERT_TRUE(view.contains(i * 2));
+      ASSERT_FALSE(view.contains(i * 2 + 1));
+    }
+    EXPECT_FALSE(view.contains(-1));
+  }
+}
+
+TEST(btal_views_suite, compressed_equal_keys_test) {
+  // Blocks whose keys all equal their base store no offsets.
+  binary_tree_array_list<int> list;
+  for (int i = 0; i < 100; i++) {
+    list.insert(7);
+  }
+  compressed_view<int> view(list);
+  EXPECT_EQ(view.size(), 100);
+  EXPECT_TRUE(view.contains(7));
+  EXPECT_FALSE(view.contains(6));
+  EXPECT_FALSE(view.contains(8));
+}
+
+TEST(btal_views_suite, compressed_random_test) {
+  binary_tree_array_list<int64_t> list;
+  std::vector<int64_t> values = {std::numeric_limits<int64_t>::min(),
+                                 std::numeric_limits<int64_t>::max(), -1, 0};
+  std::mt19937_64 rng(45);
+  for (int i = 0; i < 20'000; i++) {
+    values.push_back(static_cast<int64_t>(rng()));
+  }
+  for (int64_t value : values) {
+    list.insert(value);
+  }
+  for (int i = 0; i < 2'000; i++) {
+    list.remove(values[i * 7]);
+  }
+
+  compressed_view<int64_t> view(list);
+  for (int64_t value : values) {
+    ASSERT_EQ(view.contains(value), list.contains(value));
+    ASSERT_FALSE(view.contains(value ^ 1));
+  }
+}
+
+TEST(btal_views_suite, compressed_size_test) {
+  // Dense 64-bit IDs need one byte per key below the top blocks.
+  binary_tree_array_list<uint64_t> list;
+  for (uint64_t i = 0; i < 100'000; i++) {
+    list.insert((uint64_t(1) << 40) + i * 3);
+  }
+  compressed_view<uint64_t> view(list);
+  EXPECT_LT(view.bytes(), list.size() * sizeof(uint64_t) / 2);
+  EXPECT_TRUE(view.contains((uint64_t(1) << 40) + 300));
+  EXPECT_FALSE(view.contains((uint64_t(1) << 40) + 301));
+
+  binary_tree_array_list<int8_t> small;
+  for (int i = -128; i < 128; i++) {
+    small.insert(static_cast<int8_t>(i));
+  }
+  compressed_view<int8_t> small_view(small);
+  for (int i = -128; i < 128; i++) {
+    ASSERT_TRUE(small_view.contains(static_cast<int8_t>(i)));
+  }
+}